@@ -0,0 +1,395 @@
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "emulator8080.h"
+#include "emulatorpool.h"
+#include "framecapture.h"
+#include "inputlog.h"
+#include "lanes8080.h"
+#include "romset.h"
+#include "spaceinvaders.h"
+#include "threadpool.h"
+
+// Headless batch runner: executes many independent emulator instances on a
+// work-stealing pool and reports one result line per instance.
+//
+// Job file format, one instance per line ('#' starts a comment):
+//
+//     # name       manifest            cycles      [input script]
+//     attract      invaders.manifest   20000000
+//     coin-start   invaders.manifest   60000000    coin-start.input
+//
+// An input script holds 'cycle port value' lines (C number syntax) that set
+// an input port once the instance has run that many cycles. An input log
+// recorded with --record can stand in for the script; it is replayed from
+// its first keyframe, frame by frame. Every instance gets the board's
+// mid-screen and VBlank interrupts.
+//
+// --hash-dir writes each instance's per-frame video RAM hashes to
+// DIR/name.hashes; --golden-dir checks them against DIR/name.hashes from an
+// earlier run, failing the instance on the first frame that differs, and
+// --dump-dir renders the differing frames to DIR/name-frame.png.
+//
+// Instances come from one EmulatorPool per manifest with a slot per worker,
+// so a job reuses a reset instance rather than building a new one.
+//
+// --lanes 16|32 runs up to that many jobs on one manifest together on the
+// experimental lane-parallel core (lanes8080.h), handing the rest of them
+// to the backend once the lanes stop running together. Jobs under
+// --trace-dir still run one at a time.
+
+struct InputEvent {
+    uint64_t cycle;
+    uint8_t  port;
+    uint8_t  value;
+};
+
+struct Job {
+    std::string name;
+    std::string manifest;
+    uint64_t    cycles;
+    std::string inputScript;
+    std::vector<InputEvent> input;
+    bool        replay = false;
+    InputPlayer inputLog;
+
+    // Filled in by the worker
+    std::string status;
+    uint64_t    cyclesRun = 0;
+    uint16_t    pc = 0;
+    double      milliseconds = 0;
+};
+
+static bool LoadInputScript(const std::string& path, std::vector<InputEvent>& events) {
+    FILE *script = fopen(path.c_str(), "r");
+    if (script == NULL) {
+        printf("error: Couldn't open input script %s\n", path.c_str());
+        return false;
+    }
+    char line[256];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), script)) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        unsigned long long cycle;
+        unsigned int port, value;
+        int fields = sscanf(line, "%lli %i %i", &cycle, &port, &value);
+        if (fields <= 0) continue;
+        if (fields != 3 || port > 0xff || value > 0xff) {
+            printf("error: %s:%d: expected 'cycle port value'\n", path.c_str(), lineNumber);
+            fclose(script);
+            return false;
+        }
+        if (!events.empty() && cycle < events.back().cycle) {
+            printf("error: %s:%d: events must be in cycle order\n", path.c_str(), lineNumber);
+            fclose(script);
+            return false;
+        }
+        events.push_back({cycle, (uint8_t)port, (uint8_t)value});
+    }
+    fclose(script);
+    return true;
+}
+
+static bool LoadJobs(const char* path, std::vector<Job>& jobs) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        printf("error: Couldn't open job file %s\n", path);
+        return false;
+    }
+    char line[1024];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file)) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        char name[256], manifest[512], script[512];
+        unsigned long long cycles;
+        int fields = sscanf(line, "%255s %511s %llu %511s", name, manifest, &cycles, script);
+        if (fields <= 0) continue;
+        if (fields < 3) {
+            printf("error: %s:%d: expected 'name manifest cycles [input script]'\n", path, lineNumber);
+            fclose(file);
+            return false;
+        }
+        Job job;
+        job.name = name;
+        job.manifest = manifest;
+        job.cycles = cycles;
+        if (fields == 4) {
+            job.inputScript = script;
+            job.replay = InputPlayer::IsInputLog(script);
+            if (job.replay ? !job.inputLog.Open(script) : !LoadInputScript(job.inputScript, job.input)) {
+                fclose(file);
+                return false;
+            }
+        }
+        jobs.push_back(job);
+    }
+    fclose(file);
+    return true;
+}
+
+struct Directories {
+    const char *trace = NULL;
+    const char *hashes = NULL;
+    const char *golden = NULL;
+    const char *dump = NULL;
+};
+
+// Hashing, golden checks and dumps as the directories ask; false if the
+// golden hashes could not be loaded
+static bool StartCapture(FrameCapture& capture, const Job& job, const Directories& directories) {
+    if (directories.hashes) capture.OpenOutput((std::string(directories.hashes) + "/" + job.name + ".hashes").c_str());
+    if (directories.dump) capture.SetDumpPrefix(std::string(directories.dump) + "/" + job.name + "-");
+    return !directories.golden || capture.LoadGolden((std::string(directories.golden) + "/" + job.name + ".hashes").c_str());
+}
+
+// Sets the input ports the script has reached and returns the cycle to run
+// to before the next change
+static uint64_t ApplyInput(Job& job, Emulator8080& emulator, size_t& nextEvent) {
+    while (nextEvent < job.input.size() && job.input[nextEvent].cycle <= emulator.Cycles()) {
+        emulator.SetInputPort(job.input[nextEvent].port, job.input[nextEvent].value);
+        nextEvent++;
+    }
+    uint64_t until = job.cycles;
+    if (nextEvent < job.input.size() && job.input[nextEvent].cycle < until) until = job.input[nextEvent].cycle;
+    return until;
+}
+
+static void FinishJob(Job& job, const Emulator8080& emulator, const FrameCapture& capture, bool failed, bool badGolden, bool stopped) {
+    job.status = failed ? "bad input log" : badGolden ? "no golden hashes" : stopped ? "halted" : "ok";
+    if (job.status == "ok" && capture.Mismatches() != 0) {
+        char status[64];
+        snprintf(status, sizeof(status), "mismatch frame %llu", (unsigned long long)capture.FirstMismatch());
+        job.status = status;
+    }
+    job.cyclesRun = emulator.Cycles();
+    job.pc = emulator.ProgramCounter();
+}
+
+// Runs a job from where it stands to its end on the instance's backend
+static void RunRest(Job& job, Emulator8080& emulator, size_t& nextEvent, bool& stopped) {
+    while (job.replay && emulator.Cycles() < job.cycles && !stopped) stopped = !job.inputLog.Step(emulator);
+    while (!job.replay && emulator.Cycles() < job.cycles && !stopped) {
+        uint64_t until = ApplyInput(job, emulator, nextEvent);
+        emulator.RunFor(until - emulator.Cycles());
+        stopped = emulator.Halted() && !emulator.InterruptsEnabled();
+    }
+}
+
+static void RunJob(Job& job, EmulatorPool& instances, Emulator8080::Backend backend, const Directories& directories) {
+    auto start = std::chrono::steady_clock::now();
+    Emulator8080 *instance = instances.Acquire();
+    if (instance == nullptr) {
+        job.status = "no free instance";
+        return;
+    }
+    Emulator8080& emulator = *instance;
+    emulator.SetBackend(backend);
+    TraceWriter trace;
+    if (directories.trace) {
+        std::string path = std::string(directories.trace) + "/" + job.name + ".trace";
+        if (trace.Open(path.c_str())) emulator.SetTraceWriter(&trace);
+    }
+    ScheduleVideoInterrupts(emulator);
+
+    size_t nextEvent = 0;
+    bool stopped = false;
+    FrameCapture capture(emulator);
+    bool badGolden = !StartCapture(capture, job, directories);
+    bool failed = job.replay && !job.inputLog.Seek(emulator, 0);
+    if (!failed) RunRest(job, emulator, nextEvent, stopped);
+    emulator.SetTraceWriter(nullptr);
+    trace.Close();
+
+    FinishJob(job, emulator, capture, failed, badGolden, stopped);
+    // The reset drops the capture's VBlank event along with the interrupts
+    instances.Release(instance);
+    job.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs jobs on one manifest side by side on a lane group, each to the same
+// end as RunJob on the threaded backend; every job reports the group's time.
+// Script jobs stop at every input change in the group and replays at every
+// frame boundary, which keeps the lanes on the same cycles and so on the
+// same instructions. A step across the lanes costs about as much as
+// scalar instructions for half of them, so once fewer than half the lanes
+// have work left, or the steps so far average fewer than half the lanes,
+// the jobs finish one at a time on the backend.
+const uint64_t SAMPLE_DISPATCHES = 20000;
+
+template<int Lanes>
+static void RunLaneJobs(const std::vector<Job*>& jobs, EmulatorPool& instances, Emulator8080::Backend backend, const Directories& directories) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Job*> running;
+    std::vector<Emulator8080*> emulators;
+    std::vector<std::unique_ptr<FrameCapture>> captures;
+    std::vector<bool> badGolden, failed;
+    for (Job *job : jobs) {
+        Emulator8080 *instance = instances.Acquire();
+        if (instance == nullptr) {
+            job->status = "no free instance";
+            continue;
+        }
+        instance->SetBackend(backend);
+        ScheduleVideoInterrupts(*instance);
+        captures.emplace_back(new FrameCapture(*instance));
+        badGolden.push_back(!StartCapture(*captures.back(), *job, directories));
+        failed.push_back(job->replay && !job->inputLog.Seek(*instance, 0));
+        running.push_back(job);
+        emulators.push_back(instance);
+    }
+    if (running.empty()) return;
+
+    LaneGroup<Lanes> group(emulators);
+    size_t count = running.size();
+    size_t nextEvent[Lanes] = {};
+    bool stopped[Lanes] = {};
+    uint64_t frameEnd[Lanes] = {};  // end of the replay frame under way, 0 between frames
+    uint64_t targets[Lanes];
+    bool active[Lanes];
+    for (;;) {
+        uint64_t until = UINT64_MAX;
+        int working = 0;
+        for (size_t i = 0; i < count; i++) {
+            Emulator8080& emulator = *emulators[i];
+            active[i] = !failed[i] && !stopped[i] && (frameEnd[i] != 0 || emulator.Cycles() < running[i]->cycles);
+            if (!active[i]) continue;
+            working++;
+            if (running[i]->replay && frameEnd[i] == 0) frameEnd[i] = running[i]->inputLog.StartFrame(emulator);
+            until = std::min(until, running[i]->replay ? frameEnd[i] : ApplyInput(*running[i], emulator, nextEvent[i]));
+        }
+        uint64_t instructions = group.LockstepInstructions() + group.ScalarInstructions();
+        bool sparse = group.Dispatches() >= SAMPLE_DISPATCHES && instructions < group.Dispatches() * Lanes / 2;
+        if (working * 2 < Lanes || sparse) break;
+        for (size_t i = 0; i < count; i++) targets[i] = active[i] ? until : emulators[i]->Cycles();
+        group.RunTo(targets);
+        for (size_t i = 0; i < count; i++) {
+            if (!active[i]) continue;
+            Emulator8080& emulator = *emulators[i];
+            bool halted = emulator.Halted() && !emulator.InterruptsEnabled();
+            if (!running[i]->replay) stopped[i] = halted;
+            else if (emulator.Cycles() >= frameEnd[i] || halted) {
+                stopped[i] = !running[i]->inputLog.FinishFrame(emulator);
+                frameEnd[i] = 0;
+            }
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (failed[i] || stopped[i]) continue;
+        Emulator8080& emulator = *emulators[i];
+        if (frameEnd[i] != 0) {
+            if (frameEnd[i] > emulator.Cycles()) emulator.RunFor(frameEnd[i] - emulator.Cycles());
+            stopped[i] = !running[i]->inputLog.FinishFrame(emulator);
+        }
+        RunRest(*running[i], emulator, nextEvent[i], stopped[i]);
+    }
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    for (size_t i = 0; i < count; i++) {
+        FinishJob(*running[i], *emulators[i], *captures[i], failed[i], badGolden[i], stopped[i]);
+        instances.Release(emulators[i]);
+        running[i]->milliseconds = milliseconds;
+    }
+}
+
+static void RunLanes(int lanes, const std::vector<Job*>& jobs, EmulatorPool& instances, Emulator8080::Backend backend, const Directories& directories) {
+    if (lanes == 16) RunLaneJobs<16>(jobs, instances, backend, directories);
+    else RunLaneJobs<32>(jobs, instances, backend, directories);
+}
+
+static void Usage() {
+    printf("usage: batch8080 [--threads N] [--backend threaded|blocks|jit] [--lanes 16|32]\n"
+           "                [--trace-dir DIR] [--hash-dir DIR] [--golden-dir DIR] [--dump-dir DIR] jobs.txt\n");
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int threads = std::thread::hardware_concurrency();
+    Emulator8080::Backend backend = Emulator8080::BACKEND_THREADED;
+    Directories directories;
+    int lanes = 0;
+    const char *jobFile = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc && strcmp(argv[i + 1], "threaded") == 0) { backend = Emulator8080::BACKEND_THREADED; i++; }
+        else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc && strcmp(argv[i + 1], "blocks") == 0) { backend = Emulator8080::BACKEND_BLOCK_CACHE; i++; }
+        else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc && strcmp(argv[i + 1], "jit") == 0) { backend = Emulator8080::BACKEND_JIT; i++; }
+        else if (strcmp(argv[i], "--lanes") == 0 && i + 1 < argc) lanes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--trace-dir") == 0 && i + 1 < argc) directories.trace = argv[++i];
+        else if (strcmp(argv[i], "--hash-dir") == 0 && i + 1 < argc) directories.hashes = argv[++i];
+        else if (strcmp(argv[i], "--golden-dir") == 0 && i + 1 < argc) directories.golden = argv[++i];
+        else if (strcmp(argv[i], "--dump-dir") == 0 && i + 1 < argc) directories.dump = argv[++i];
+        else if (argv[i][0] != '-' && jobFile == NULL) jobFile = argv[i];
+        else { Usage(); return 1; }
+    }
+    if (jobFile == NULL || (lanes != 0 && lanes != 16 && lanes != 32)) {
+        Usage();
+        return 1;
+    }
+    // hardware_concurrency() may not know; the pool runs at least one worker
+    if (threads == 0) threads = 1;
+
+    std::vector<Job> jobs;
+    if (!LoadJobs(jobFile, jobs)) return 1;
+
+    // Instances that use the same manifest share one ROM image
+    std::map<std::string, std::unique_ptr<RomSet>> romSets;
+    for (const Job& job : jobs) {
+        std::unique_ptr<RomSet>& roms = romSets[job.manifest];
+        if (roms) continue;
+        roms.reset(new RomSet());
+        if (!roms->LoadManifest(job.manifest.c_str())) return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        WorkStealingPool pool(threads);
+        // A worker runs one job or one lane group at a time
+        size_t slots = pool.Threads() * (lanes ? lanes : 1);
+        std::map<std::string, std::unique_ptr<EmulatorPool>> instances;
+        for (const auto& entry : romSets) instances[entry.first].reset(new EmulatorPool(*entry.second, slots));
+        std::map<std::string, std::vector<Job*>> laneJobs;
+        for (Job& job : jobs) {
+            if (lanes && !directories.trace) {
+                laneJobs[job.manifest].push_back(&job);
+                continue;
+            }
+            EmulatorPool *pooled = instances[job.manifest].get();
+            pool.Submit([&job, pooled, backend, &directories] { RunJob(job, *pooled, backend, directories); });
+        }
+        // Jobs of about the same length share a group, so its lanes run out
+        // of work together
+        for (auto& entry : laneJobs) {
+            std::vector<Job*>& sorted = entry.second;
+            std::stable_sort(sorted.begin(), sorted.end(), [](const Job* x, const Job* y) { return x->cycles < y->cycles; });
+            EmulatorPool *pooled = instances[entry.first].get();
+            for (size_t first = 0; first < sorted.size(); first += lanes) {
+                std::vector<Job*> group(sorted.begin() + first, sorted.begin() + std::min(sorted.size(), first + lanes));
+                pool.Submit([group, pooled, lanes, backend, &directories] { RunLanes(lanes, group, *pooled, backend, directories); });
+            }
+        }
+        pool.Wait();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int failures = 0;
+    uint64_t totalCycles = 0;
+    printf("%-24s %-20s %14s %6s %10s\n", "name", "status", "cycles", "pc", "ms");
+    for (const Job& job : jobs) {
+        printf("%-24s %-20s %14llu  %04x %10.1f\n", job.name.c_str(), job.status.c_str(),
+               (unsigned long long)job.cyclesRun, job.pc, job.milliseconds);
+        if (job.status != "ok") failures++;
+        totalCycles += job.cyclesRun;
+    }
+    printf("%zu instances on %u threads, %d failed, %.3f s, %.1f emulated MHz\n",
+           jobs.size(), threads, failures, seconds, totalCycles / seconds / 1e6);
+    return failures == 0 ? 0 : 2;
+}
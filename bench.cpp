@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <chrono>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+#include "emulator8080.h"
+#include "romset.h"
+
+// CPU conformance and throughput benchmark. Runs the CP/M CPU exerciser
+// programs (TST8080, 8080PRE, CPUTEST, 8080EXM) under a minimal BDOS stub,
+// decides pass/fail from what they print and reports emulated MIPS and host
+// nanoseconds per instruction.
+//
+// Suite file format, one program per line ('#' starts a comment):
+//
+//     # name     program        pass when the output contains
+//     TST8080    TST8080.COM    CPU IS OPERATIONAL
+//
+// Program paths are relative to the suite file's directory. A program fails
+// if it never prints its pass text, prints "ERROR", or does not return to
+// CP/M (jump to 0) within the instruction limit.
+
+// The BDOS stub. CP/M loads a program at 0x100 and the program calls 5 for
+// console output; the word at 6 doubles as the top of the usable memory, so
+// it points at a RET high up that the runner traps. The reset vector jumps to
+// the program once, and a later jump to 0 (warm boot) ends it.
+static const uint16_t PROGRAM_START = 0x0100;
+static const uint16_t BDOS_ENTRY = 0xfe00;
+
+struct Program {
+    std::string name;
+    std::string file;
+    std::string passText;
+
+    // Filled in by the run
+    std::string status;
+    std::string output;
+    uint64_t    instructions = 0;
+    uint64_t    cycles = 0;
+    double      seconds = 0;
+};
+
+static bool LoadSuite(const char* path, std::vector<Program>& programs) {
+    FILE *suite = fopen(path, "r");
+    if (suite == NULL) {
+        printf("error: Couldn't open suite %s\n", path);
+        return false;
+    }
+    const char *slash = strrchr(path, '/');
+    std::string directory = slash ? std::string(path, slash - path + 1) : std::string();
+
+    char line[1024];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), suite)) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        char name[256], file[512];
+        int consumed = 0;
+        int fields = sscanf(line, "%255s %511s %n", name, file, &consumed);
+        if (fields <= 0) continue;
+        std::string passText = fields == 2 ? line + consumed : "";
+        while (!passText.empty() && isspace((unsigned char)passText.back())) passText.pop_back();
+        if (passText.empty()) {
+            printf("error: %s:%d: expected 'name program pass-text'\n", path, lineNumber);
+            fclose(suite);
+            return false;
+        }
+        Program program;
+        program.name = name;
+        program.file = directory + file;
+        program.passText = passText;
+        programs.push_back(program);
+    }
+    fclose(suite);
+    return true;
+}
+
+// Console output for BDOS function 2 (character in E) and 9 (string at DE
+// terminated by '$'); every other function is ignored
+static void Bdos(const Emulator8080& emulator, std::string& output, bool echo) {
+    Emulator8080::Registers r = emulator.Snapshot();
+    size_t start = output.size();
+    if (r.c == 2) {
+        output += (char)r.e;
+    } else if (r.c == 9) {
+        const uint8_t *memory = emulator.Memory();
+        for (uint16_t address = (r.d << 8) | r.e; memory[address] != '$'; address++) output += (char)memory[address];
+    }
+    if (echo) {
+        fwrite(output.data() + start, 1, output.size() - start, stdout);
+        fflush(stdout);
+    }
+}
+
+static bool BuildImage(const Program& program, RomSet& roms) {
+    struct stat info;
+    if (stat(program.file.c_str(), &info) != 0) return false;
+
+    RomSet::Image boot;
+    boot.address = 0x0000;
+    boot.data = { 0xc3, PROGRAM_START & 0xff, PROGRAM_START >> 8, 0x00, 0x00, // JMP PROGRAM_START
+                  0xc3, BDOS_ENTRY & 0xff, BDOS_ENTRY >> 8 };                   // JMP BDOS_ENTRY
+    boot.size = boot.data.size();
+    boot.readOnly = false;
+    boot.verifyChecksum = false;
+
+    RomSet::Image bdos = boot;
+    bdos.address = BDOS_ENTRY;
+    bdos.data = { 0xc9 }; // RET
+    bdos.size = 1;
+
+    RomSet::Image code;
+    code.file = program.file;
+    code.address = PROGRAM_START;
+    code.size = info.st_size;
+    code.readOnly = false;
+    code.verifyChecksum = false;
+
+    if (!roms.AddImage(boot) || !roms.AddImage(bdos) || !roms.AddImage(code)) {
+        printf("error: %s does not fit below $%04x\n", program.file.c_str(), BDOS_ENTRY);
+        return false;
+    }
+    return roms.Build();
+}
+
+static void RunProgram(Program& program, const RomSet& roms, Emulator8080::Backend backend, uint64_t limit, bool echo) {
+    Emulator8080 emulator;
+    emulator.SetBackend(backend);
+    emulator.Initialize(roms);
+
+    emulator.RunUntil([](const Emulator8080& e) { return e.ProgramCounter() == PROGRAM_START; });
+
+    auto start = std::chrono::steady_clock::now();
+    while (!emulator.Halted() && emulator.Instructions() < limit) {
+        emulator.RunUntil([limit](const Emulator8080& e) {
+            uint16_t pc = e.ProgramCounter();
+            return pc == BDOS_ENTRY || pc == 0 || e.Instructions() >= limit;
+        });
+        if (emulator.ProgramCounter() != BDOS_ENTRY) break;
+        Bdos(emulator, program.output, echo);
+        emulator.Run(1); // the RET back into the program
+    }
+    program.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    program.instructions = emulator.Instructions();
+    program.cycles = emulator.Cycles();
+
+    bool warmBoot = !emulator.Halted() && emulator.ProgramCounter() == 0;
+    if (!warmBoot) program.status = emulator.Halted() ? "halted" : "timeout";
+    else if (program.output.find("ERROR") != std::string::npos) program.status = "error";
+    else if (program.output.find(program.passText) == std::string::npos) program.status = "fail";
+    else program.status = "pass";
+}
+
+static void Usage() {
+    printf("usage: bench8080 [--backend threaded|blocks|jit] [--repeat n] [--limit instructions] [--verbose] suite\n");
+}
+
+int main(int argc, char* argv[]) {
+    Emulator8080::Backend backend = Emulator8080::BACKEND_THREADED;
+    int repeat = 1;
+    uint64_t limit = UINT64_MAX;
+    bool verbose = false;
+    const char *suiteFile = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc && strcmp(argv[i + 1], "threaded") == 0) { backend = Emulator8080::BACKEND_THREADED; i++; }
+        else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc && strcmp(argv[i + 1], "blocks") == 0) { backend = Emulator8080::BACKEND_BLOCK_CACHE; i++; }
+        else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc && strcmp(argv[i + 1], "jit") == 0) { backend = Emulator8080::BACKEND_JIT; i++; }
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) limit = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--verbose") == 0) verbose = true;
+        else if (argv[i][0] != '-' && suiteFile == NULL) suiteFile = argv[i];
+        else { Usage(); return 1; }
+    }
+    if (suiteFile == NULL) {
+        Usage();
+        return 1;
+    }
+
+    std::vector<Program> programs;
+    if (!LoadSuite(suiteFile, programs)) return 1;
+
+    int failures = 0, missing = 0;
+    uint64_t totalInstructions = 0;
+    double totalSeconds = 0;
+    printf("%-12s %-8s %16s %16s %10s %9s %9s\n", "name", "status", "instructions", "cycles", "seconds", "MIPS", "ns/inst");
+    for (Program& program : programs) {
+        RomSet roms;
+        if (!BuildImage(program, roms)) {
+            printf("%-12s %-8s (%s not found)\n", program.name.c_str(), "missing", program.file.c_str());
+            missing++;
+            continue;
+        }
+        // Every repetition runs the whole program; the fastest one is reported
+        double best = 0;
+        for (int run = 0; run < repeat; run++) {
+            program.output.clear();
+            RunProgram(program, roms, backend, limit, verbose && run == 0);
+            if (run == 0 || program.seconds < best) best = program.seconds;
+        }
+        program.seconds = best;
+        if (verbose) printf("\n");
+
+        double mips = program.instructions / program.seconds / 1e6;
+        double nanoseconds = program.seconds * 1e9 / program.instructions;
+        printf("%-12s %-8s %16llu %16llu %10.3f %9.1f %9.2f\n", program.name.c_str(), program.status.c_str(),
+               (unsigned long long)program.instructions, (unsigned long long)program.cycles, program.seconds, mips, nanoseconds);
+        if (program.status != "pass") {
+            failures++;
+            if (!verbose && !program.output.empty()) printf("%s\n", program.output.c_str());
+        }
+        totalInstructions += program.instructions;
+        totalSeconds += program.seconds;
+    }
+    if (totalSeconds > 0)
+        printf("%zu programs, %d failed, %d missing, %.1f MIPS, %.2f ns/instruction\n", programs.size(), failures, missing,
+               totalInstructions / totalSeconds / 1e6, totalSeconds * 1e9 / totalInstructions);
+    return failures == 0 ? 0 : 2;
+}
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lockstep.h"
+#include "romset.h"
+
+// Lock-step differential runner: executes the same ROM set on two cores and
+// reports the first divergence.
+//
+//     compare8080 [--left ENGINE] [--right ENGINE] [--instructions N] [--port P=V]... manifest
+//
+// ENGINE is switch (the reference), threaded, blocks or jit. Defaults compare
+// the reference switch against the threaded handler table.
+
+static void Usage() {
+    printf("usage: compare8080 [--left switch|threaded|blocks|jit] [--right switch|threaded|blocks|jit]\n"
+           "                   [--instructions N] [--port P=V]... manifest\n");
+}
+
+int main(int argc, char* argv[]) {
+    LockstepHarness::Engine left = LockstepHarness::ENGINE_SWITCH;
+    LockstepHarness::Engine right = LockstepHarness::ENGINE_THREADED;
+    unsigned long long instructions = 10000000;
+    const char *manifest = NULL;
+    struct { unsigned int port, value; } ports[256];
+    int portCount = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--left") == 0 && i + 1 < argc) {
+            if (!LockstepHarness::ParseEngine(argv[++i], left)) { Usage(); return 1; }
+        } else if (strcmp(argv[i], "--right") == 0 && i + 1 < argc) {
+            if (!LockstepHarness::ParseEngine(argv[++i], right)) { Usage(); return 1; }
+        } else if (strcmp(argv[i], "--instructions") == 0 && i + 1 < argc) {
+            instructions = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc && portCount < 256) {
+            if (sscanf(argv[++i], "%i=%i", &ports[portCount].port, &ports[portCount].value) != 2) { Usage(); return 1; }
+            portCount++;
+        } else if (argv[i][0] != '-' && manifest == NULL) {
+            manifest = argv[i];
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+    if (manifest == NULL) {
+        Usage();
+        return 1;
+    }
+
+    RomSet roms;
+    if (!roms.LoadManifest(manifest)) return 1;
+    LockstepHarness harness(roms, left, right);
+    for (int i = 0; i < portCount; i++) harness.SetInputPort(ports[i].port, ports[i].value);
+
+    if (!harness.Run(instructions)) {
+        printf("%s", harness.Divergence().c_str());
+        return 2;
+    }
+    printf("%s and %s agree for %llu instructions", LockstepHarness::EngineName(left),
+           LockstepHarness::EngineName(right), (unsigned long long)harness.Instructions());
+    if (harness.Halted()) printf(" (both halted at %04x)", harness.ProgramCounter());
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "disassembler8080.h"
+#include "romset.h"
+
+// Whole-ROM listing: loads a manifest, follows the code from the entry
+// points through the read-only images and prints a labeled listing. The
+// default entry points are the reset vector and the RST 1/RST 2 interrupt
+// handlers the Space Invaders board jumps to.
+
+static void Usage() {
+    printf("usage: disasm8080 [--entry address]... [--time] manifest\n");
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<uint16_t> entries;
+    bool time = false;
+    const char *manifest = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--entry") == 0 && i + 1 < argc) entries.push_back(strtoul(argv[++i], NULL, 16));
+        else if (strcmp(argv[i], "--time") == 0) time = true;
+        else if (argv[i][0] != '-' && manifest == NULL) manifest = argv[i];
+        else { Usage(); return 1; }
+    }
+    if (manifest == NULL) {
+        Usage();
+        return 1;
+    }
+    if (entries.empty()) entries = { 0x0000, 0x0008, 0x0010 };
+
+    RomSet roms;
+    if (!roms.LoadManifest(manifest)) return 1;
+    uint32_t start = RomSet::MEMORY_SIZE, end = 0;
+    for (const RomSet::Image& image : roms.Images()) {
+        if (!image.readOnly) continue;
+        if (image.address < start) start = image.address;
+        if (image.address + image.size > end) end = image.address + image.size;
+    }
+    if (end == 0) {
+        printf("error: %s has no read-only images to disassemble\n", manifest);
+        return 1;
+    }
+
+    CodeAnalysis analysis;
+    auto begin = std::chrono::steady_clock::now();
+    analysis.Analyze(roms.Pristine(), start, end, entries.data(), entries.size());
+    double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+    analysis.WriteListing(stdout);
+    if (time) fprintf(stderr, "analysis of $%04x-$%04x: %.1f us\n", start, end - 1, microseconds);
+    return 0;
+}
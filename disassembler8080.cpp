@@ -0,0 +1,156 @@
+#include "disassembler8080.h"
+
+#include <algorithm>
+#include <string.h>
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+static char* PutText(char* out, const char* text) {
+    while (*text) *out++ = *text++;
+    return out;
+}
+
+static char* PutHex(char* out, uint16_t value, int digits) {
+    for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4) *out++ = HEX_DIGITS[(value >> shift) & 0xf];
+    return out;
+}
+
+// Copies a line built in a local buffer out to the caller's buffer
+static size_t CopyOut(const char* line, size_t length, char* buffer, size_t size) {
+    if (size == 0) return length;
+    size_t copied = length < size ? length : size - 1;
+    memcpy(buffer, line, copied);
+    buffer[copied] = '\0';
+    return copied;
+}
+
+Instruction Disassembler::DecodeBytes(const uint8_t bytes[3], uint16_t address) {
+    Instruction instruction;
+    instruction.address = address;
+    instruction.info = &OPCODE_INFO[bytes[0]];
+    for (int i = 0; i < 3; i++) instruction.bytes[i] = i < instruction.info->length ? bytes[i] : 0;
+    return instruction;
+}
+
+Instruction Disassembler::Decode(const uint8_t* memory, uint16_t address) {
+    uint8_t bytes[3] = { memory[address], memory[(uint16_t)(address + 1)], memory[(uint16_t)(address + 2)] };
+    return DecodeBytes(bytes, address);
+}
+
+size_t Disassembler::Format(const Instruction& instruction, char* buffer, size_t size, const CodeAnalysis* labels) {
+    const OpcodeInfo& info = *instruction.info;
+    char line[MAX_FORMATTED];
+    char *out = PutText(line, info.mnemonic);
+    if (info.registers[0] == '\0' && info.operand == OPERAND_NONE) return CopyOut(line, out - line, buffer, size);
+
+    // Operands start in column 8
+    while (out < line + 7) *out++ = ' ';
+    out = PutText(out, info.registers);
+    if (info.operand != OPERAND_NONE && info.registers[0] != '\0') *out++ = ',';
+    uint16_t operand = instruction.Operand();
+    switch (info.operand) {
+        case OPERAND_NONE: break;
+        case OPERAND_BYTE: out = PutHex(PutText(out, "#$"), operand, 2); break;
+        case OPERAND_WORD: out = PutHex(PutText(out, "#$"), operand, 4); break;
+        case OPERAND_ADDRESS: out = PutHex(PutText(out, "$"), operand, 4); break;
+        case OPERAND_TARGET:
+            if (labels && labels->IsLabel(operand)) out += labels->FormatLabel(operand, out, line + sizeof(line) - out);
+            else out = PutHex(PutText(out, "$"), operand, 4);
+            break;
+    }
+    return CopyOut(line, out - line, buffer, size);
+}
+
+size_t CodeAnalysis::FormatLabel(uint16_t address, char* buffer, size_t size) const {
+    char label[6];
+    label[0] = IsSubroutine(address) ? 'S' : 'L';
+    PutHex(label + 1, address, 4);
+    return CopyOut(label, 5, buffer, size);
+}
+
+void CodeAnalysis::Analyze(const uint8_t* memory, uint16_t start, uint32_t end, const uint16_t* entries, size_t count) {
+    this->memory = memory;
+    this->start = start;
+    this->end = end;
+    instructions = 0;
+    std::fill(marks.begin(), marks.end(), 0);
+    pending.clear();
+    auto inRange = [start, end](uint32_t address) { return address >= start && address < end; };
+    auto follow = [&](uint16_t target, uint8_t mark) {
+        if (!inRange(target)) return;
+        marks[target] |= mark;
+        if (!(marks[target] & MARK_INSTRUCTION)) pending.push_back(target);
+    };
+    for (size_t i = 0; i < count; i++) follow(entries[i], MARK_CALL_TARGET);
+
+    while (!pending.empty()) {
+        uint32_t address = pending.back();
+        pending.pop_back();
+        // Decode straight-line code until control cannot fall through, the
+        // range ends or the path joins code already decoded
+        while (inRange(address) && !(marks[address] & (MARK_INSTRUCTION | MARK_OPERAND))) {
+            Instruction instruction = Disassembler::Decode(memory, address);
+            if (!inRange(address + instruction.Length() - 1)) break;
+            marks[address] |= MARK_INSTRUCTION;
+            for (int i = 1; i < instruction.Length(); i++) marks[address + i] |= MARK_OPERAND;
+            instructions++;
+
+            Flow flow = instruction.info->flow;
+            if (flow == FLOW_JUMP || flow == FLOW_BRANCH) follow(instruction.Target(), MARK_JUMP_TARGET);
+            else if (flow == FLOW_CALL || flow == FLOW_RESTART) follow(instruction.Target(), MARK_CALL_TARGET);
+            if (flow == FLOW_JUMP || flow == FLOW_RETURN || flow == FLOW_INDIRECT) break;
+            address += instruction.Length();
+        }
+    }
+}
+
+void CodeAnalysis::WriteListing(FILE* out) const {
+    size_t dataBytes = 0, labels = 0;
+    for (uint32_t address = start; address < end; address++) {
+        if (IsLabel(address)) labels++;
+        if (!(marks[address] & (MARK_INSTRUCTION | MARK_OPERAND))) dataBytes++;
+    }
+    fprintf(out, "; $%04x-$%04x: %zu instructions, %zu data bytes, %zu labels\n", start, end - 1, instructions, dataBytes, labels);
+
+    // Lines are gathered into one large block per write
+    char block[16384];
+    size_t used = 0;
+    uint32_t address = start;
+    while (address < end) {
+        if (used > sizeof(block) - 160) {
+            fwrite(block, 1, used, out);
+            used = 0;
+        }
+        char *line = block + used;
+        char *p = line;
+        if (IsLabel(address)) {
+            p += FormatLabel(address, p, 8);
+            p = PutText(p, ":\n");
+        }
+        p = PutText(PutHex(p, address, 4), "  ");
+        if (IsInstruction(address)) {
+            Instruction instruction = Disassembler::Decode(memory, address);
+            for (int i = 0; i < 3; i++) {
+                if (i < instruction.Length()) p = PutHex(p, instruction.bytes[i], 2);
+                else p = PutText(p, "  ");
+                *p++ = ' ';
+            }
+            p = PutText(p, "  ");
+            p += Disassembler::Format(instruction, p, Disassembler::MAX_FORMATTED, this);
+            address += instruction.Length();
+        } else {
+            // Up to 8 data bytes, stopping at code and labels
+            p = PutText(p, "           DB     ");
+            uint32_t run = address;
+            do {
+                if (run != address) *p++ = ',';
+                p = PutHex(PutText(p, "$"), memory[run], 2);
+                run++;
+            } while (run < end && run - address < 8 && !(marks[run] & (MARK_INSTRUCTION | MARK_OPERAND)) && !IsLabel(run));
+            address = run;
+        }
+        *p++ = '\n';
+        used += p - line;
+    }
+    fwrite(block, 1, used, out);
+}
@@ -0,0 +1,88 @@
+#ifndef _DISASSEMBLER8080_H_
+#define _DISASSEMBLER8080_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "opcodes8080.h"
+
+// One decoded instruction. It copies its bytes and points into OPCODE_INFO,
+// so it owns nothing and outlives the memory it was decoded from.
+struct Instruction {
+    uint16_t            address;
+    uint8_t             bytes[3];   // opcode and operands, unused ones zero
+    const OpcodeInfo    *info;
+
+    uint8_t Opcode() const { return bytes[0]; }
+    uint8_t Length() const { return info->length; }
+    uint16_t Next() const { return address + info->length; }
+    // The immediate byte or word, 0 when there is none
+    uint16_t Operand() const {
+        return info->operand == OPERAND_NONE ? 0 : info->operand == OPERAND_BYTE ? bytes[1] : bytes[1] | (bytes[2] << 8);
+    }
+    // Where a jump, call or RST transfers control
+    bool HasTarget() const { return info->operand == OPERAND_TARGET || info->flow == FLOW_RESTART; }
+    uint16_t Target() const { return info->flow == FLOW_RESTART ? bytes[0] & 0x38 : Operand(); }
+};
+
+class CodeAnalysis;
+
+// Table-driven decoding and formatting; nothing here allocates
+class Disassembler {
+    public:
+        // Decodes at address in a 64 KiB memory image, wrapping at the top
+        static Instruction Decode(const uint8_t* memory, uint16_t address);
+        // Decodes instruction bytes held elsewhere, e.g. in a trace record
+        static Instruction DecodeBytes(const uint8_t bytes[3], uint16_t address);
+
+        // Writes the instruction as "MVI    A,#$20" or "JMP    $18d4" into
+        // buffer, truncated to size and NUL terminated, and returns its
+        // length. Jump and call targets the analysis labeled are written as
+        // their labels.
+        static size_t Format(const Instruction& instruction, char* buffer, size_t size, const CodeAnalysis* labels = nullptr);
+        static const size_t MAX_FORMATTED = 24;
+};
+
+// Recursive-descent code discovery over a ROM. Starting from the entry
+// points it follows fall-through, jumps, branches, calls and RSTs, and
+// marks instruction starts and the addresses they transfer control to.
+// Code reached only through PCHL or computed returns is not found and is
+// listed as data.
+class CodeAnalysis {
+    public:
+        CodeAnalysis() : marks(0x10000) {}
+
+        // Analyzes [start, end) of memory, a 64 KiB image
+        void Analyze(const uint8_t* memory, uint16_t start, uint32_t end, const uint16_t* entries, size_t count);
+
+        bool IsInstruction(uint16_t address) const { return marks[address] & MARK_INSTRUCTION; }
+        // Targets that land inside another instruction's operand get no label
+        bool IsLabel(uint16_t address) const {
+            return (marks[address] & (MARK_JUMP_TARGET | MARK_CALL_TARGET)) && !(marks[address] & MARK_OPERAND);
+        }
+        bool IsSubroutine(uint16_t address) const { return marks[address] & MARK_CALL_TARGET; }
+        size_t Instructions() const { return instructions; }
+        // Writes "S18d4" for call targets and "L18d4" for other labels;
+        // returns the length
+        size_t FormatLabel(uint16_t address, char* buffer, size_t size) const;
+
+        // Labeled listing of the analyzed range: address, bytes and
+        // disassembly for code, DB lines for everything else
+        void WriteListing(FILE* out) const;
+
+    private:
+        static const uint8_t MARK_INSTRUCTION = 0x01;
+        static const uint8_t MARK_OPERAND = 0x02;
+        static const uint8_t MARK_JUMP_TARGET = 0x04;
+        static const uint8_t MARK_CALL_TARGET = 0x08;
+
+        const uint8_t *memory = nullptr;
+        uint16_t start = 0;
+        uint32_t end = 0;
+        size_t instructions = 0;
+        std::vector<uint8_t> marks;
+        std::vector<uint16_t> pending;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "emulationthread.h"
+
+#include <stdio.h>
+#include <chrono>
+#include "savestate.h"
+#include "spaceinvaders.h"
+
+void EmulationThread::Start() {
+    stop.store(false);
+    running.store(true, std::memory_order_release);
+    thread = std::thread([this] { Run(); });
+}
+
+void EmulationThread::Stop() {
+    stop.store(true);
+    if (thread.joinable()) thread.join();
+}
+
+void EmulationThread::ApplyInput() {
+    InputLatch& latch = emulator.Io().Get<InputLatch>();
+    InputEvent event;
+    while (input.Pop(event)) {
+        uint8_t value = latch.Get(event.port);
+        latch.Set(event.port, event.pressed ? value | event.mask : value & ~event.mask);
+    }
+}
+
+void EmulationThread::StopRecording(const char* reason) {
+    if (recorder == nullptr || !recorder->Recording()) return;
+    recorder->Close();
+    printf("Input recording stopped after %llu frames: %s\n", (unsigned long long)recorder->Frames(), reason);
+}
+
+void EmulationThread::PublishFrame() {
+    VideoDirtyMap dirty = emulator.TakeVideoDirty();
+    for (VideoDirtyMap& slot : stale) slot.Merge(dirty);
+
+    int slot = frames.BackIndex();
+    Frame& frame = frames.Back();
+    renderer.Render(emulator.Memory(), stale[slot], frame.pixels.data(), Renderer::WIDTH);
+    stale[slot].Clear();
+    frame.changed = dirty;
+    frame.number = ++frameNumber;
+    frames.Publish();
+}
+
+void EmulationThread::Run() {
+    running.store(true, std::memory_order_release);
+    // Every slot starts out black, whatever video RAM holds
+    for (VideoDirtyMap& slot : stale) slot.MarkAll();
+
+    const auto frameDuration = std::chrono::microseconds(1000000 / FRAMES_PER_SECOND);
+    auto nextFrame = std::chrono::steady_clock::now();
+    uint64_t frameEnd = emulator.Cycles();
+    rewind.Capture();
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (saveRequested.exchange(false, std::memory_order_relaxed) && SaveState::SaveFile(emulator, saveFile.c_str()))
+            printf("Saved state to %s\n", saveFile.c_str());
+        if (loadRequested.exchange(false, std::memory_order_relaxed) && SaveState::LoadFile(emulator, saveFile.c_str())) {
+            // History before the load no longer leads to the current state
+            StopRecording("state loaded");
+            rewind.Clear();
+            rewind.Capture();
+            frameEnd = emulator.Cycles();
+        }
+
+        if (rewinding.load(std::memory_order_relaxed)) {
+            StopRecording("rewound");
+            rewind.Rewind(1);
+            frameEnd = emulator.Cycles();
+        } else {
+            ApplyInput();
+            if (recorder) recorder->Frame(emulator);
+            // Run a whole frame's worth of cycles in one call; any overshoot
+            // of the last instruction is taken out of the next frame's budget
+            frameEnd += CYCLES_PER_FRAME;
+            if (frameEnd > emulator.Cycles())
+                emulator.RunFor(frameEnd - emulator.Cycles());
+            if (emulator.Halted() && !emulator.InterruptsEnabled()) {
+                printf("Error: CPU halted with interrupts disabled at %04x\n", emulator.ProgramCounter());
+                break;
+            }
+            rewind.Capture();
+        }
+        PublishFrame();
+
+        if (fastForward.load(std::memory_order_relaxed)) {
+            nextFrame = std::chrono::steady_clock::now();
+        } else {
+            nextFrame += frameDuration;
+            std::this_thread::sleep_until(nextFrame);
+        }
+    }
+    if (recorder) recorder->Close();
+    running.store(false, std::memory_order_release);
+}
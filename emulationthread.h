@@ -0,0 +1,90 @@
+#ifndef _EMULATIONTHREAD_H_
+#define _EMULATIONTHREAD_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "emulator8080.h"
+#include "handoff.h"
+#include "inputlog.h"
+#include "renderer.h"
+#include "rewind.h"
+
+// Runs an emulator frame by frame on its own thread, paced at the board's
+// 60 Hz unless fast-forwarding. Every frame is rendered on this thread into
+// a triple buffer, so the display thread only uploads and presents, and a
+// vsync stall there never holds emulation back. Input arrives through an
+// SPSC ring that is drained once per frame. Each frame is also captured
+// for rewind, and saves, loads and rewinding are requested through flags the
+// frame loop picks up between frames.
+class EmulationThread {
+    public:
+        struct Frame {
+            std::vector<uint32_t> pixels = std::vector<uint32_t>(Renderer::WIDTH * Renderer::HEIGHT, Renderer::PIXEL_OFF);
+            VideoDirtyMap changed;  // lines that differ from the previous frame
+            uint64_t number = 0;    // frames are numbered from 1
+        };
+
+        // Sets (pressed) or clears the mask bits of an input port
+        struct InputEvent {
+            uint8_t port;
+            uint8_t mask;
+            bool    pressed;
+        };
+
+        explicit EmulationThread(Emulator8080& emulator) : emulator(emulator), rewind(emulator) {}
+        ~EmulationThread() { Stop(); }
+        EmulationThread(const EmulationThread&) = delete;
+        EmulationThread& operator=(const EmulationThread&) = delete;
+
+        void Start();
+        void Stop();
+        // The frame loop itself, for running it on the calling thread;
+        // returns after Stop or when the CPU halts for good
+        void Run();
+        bool Running() const { return running.load(std::memory_order_acquire); }
+
+        // Consumer side of the frame handoff (one display thread)
+        TripleBuffer<Frame>& Frames() { return frames; }
+        // Producer side of the input ring (one input thread); false if full
+        bool PushInput(const InputEvent& event) { return input.Push(event); }
+        // Runs frames back to back instead of at 60 Hz
+        void SetFastForward(bool enabled) { fastForward.store(enabled, std::memory_order_relaxed); }
+        // Steps back one frame per frame instead of running while enabled
+        void SetRewinding(bool enabled) { rewinding.store(enabled, std::memory_order_relaxed); }
+        // Save-state file; set before Start
+        void SetSaveFile(const std::string& path) { saveFile = path; }
+        void RequestSave() { saveRequested.store(true, std::memory_order_relaxed); }
+        void RequestLoad() { loadRequested.store(true, std::memory_order_relaxed); }
+        // Logs every frame's input; set before Start. A rewind or load ends
+        // the recording, since a log describes one uninterrupted run.
+        void SetRecorder(InputRecorder* recorder) { this->recorder = recorder; }
+
+    private:
+        Emulator8080& emulator;
+        Renderer renderer;
+        TripleBuffer<Frame> frames;
+        // Lines changed since each slot was last rendered into; a slot can be
+        // several frames old by the time it is the back buffer again
+        VideoDirtyMap stale[3];
+        SpscRing<InputEvent, 256> input;
+        std::atomic<bool> stop{false};
+        std::atomic<bool> running{false};
+        std::atomic<bool> fastForward{false};
+        std::atomic<bool> rewinding{false};
+        std::atomic<bool> saveRequested{false};
+        std::atomic<bool> loadRequested{false};
+        RewindBuffer rewind;
+        std::string saveFile = "emulator8080.sav";
+        InputRecorder* recorder = nullptr;
+        std::thread thread;
+        uint64_t frameNumber = 0;
+
+        void ApplyInput();
+        void PublishFrame();
+        void StopRecording(const char* reason);
+};
+
+#endif
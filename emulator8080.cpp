@@ -1,338 +1,47 @@
 #include "emulator8080.h"
 
+#include <algorithm>
 #include <iostream>
+#include <string.h>
+#include <utility>
 
-int Emulator8080::Disassemble8080Opcodes(unsigned char *codebuffer, int pc) {
-    unsigned char *code = &codebuffer[pc];
-    int opbytes = 1;
-    printf("%04x ", pc);
-    switch (*code)
-    {
-        case 0x00: printf("NOP"); break;
-        case 0x01: printf("LXI    B,#$%02x%02x", code[2], code[1]); opbytes=3; break;
-        case 0x02: printf("STAX   B"); break;
-        case 0x03: printf("INX    B"); break;
-        case 0x04: printf("INR    B"); break;
-        case 0x05: printf("DCR    B"); break;
-        case 0x06: printf("MVI    B,#$%02x", code[1]); opbytes=2; break;
-        case 0x07: printf("RLC"); break;
-        case 0x08: printf("NOP"); break;
-        case 0x09: printf("DAD    B"); break;
-        case 0x0a: printf("LDAX   B"); break;
-        case 0x0b: printf("DCX    B"); break;
-        case 0x0c: printf("INR    C"); break;
-        case 0x0d: printf("DCR    C"); break;
-        case 0x0e: printf("MVI    C,#$%02x", code[1]); opbytes = 2;    break;
-        case 0x0f: printf("RRC"); break;
-            
-        case 0x10: printf("NOP"); break;
-        case 0x11: printf("LXI    D,#$%02x%02x", code[2], code[1]); opbytes=3; break;
-        case 0x12: printf("STAX   D"); break;
-        case 0x13: printf("INX    D"); break;
-        case 0x14: printf("INR    D"); break;
-        case 0x15: printf("DCR    D"); break;
-        case 0x16: printf("MVI    D,#$%02x", code[1]); opbytes=2; break;
-        case 0x17: printf("RAL"); break;
-        case 0x18: printf("NOP"); break;
-        case 0x19: printf("DAD    D"); break;
-        case 0x1a: printf("LDAX   D"); break;
-        case 0x1b: printf("DCX    D"); break;
-        case 0x1c: printf("INR    E"); break;
-        case 0x1d: printf("DCR    E"); break;
-        case 0x1e: printf("MVI    E,#$%02x", code[1]); opbytes = 2; break;
-        case 0x1f: printf("RAR"); break;
-            
-        case 0x20: printf("NOP"); break;
-        case 0x21: printf("LXI    H,#$%02x%02x", code[2], code[1]); opbytes=3; break;
-        case 0x22: printf("SHLD   $%02x%02x", code[2], code[1]); opbytes=3; break;
-        case 0x23: printf("INX    H"); break;
-        case 0x24: printf("INR    H"); break;
-        case 0x25: printf("DCR    H"); break;
-        case 0x26: printf("MVI    H,#$%02x", code[1]); opbytes=2; break;
-        case 0x27: printf("DAA"); break;
-        case 0x28: printf("NOP"); break;
-        case 0x29: printf("DAD    H"); break;
-        case 0x2a: printf("LHLD   $%02x%02x", code[2], code[1]); opbytes=3; break;
-        case 0x2b: printf("DCX    H"); break;
-        case 0x2c: printf("INR    L"); break;
-        case 0x2d: printf("DCR    L"); break;
-        case 0x2e: printf("MVI    L,#$%02x", code[1]); opbytes = 2; break;
-        case 0x2f: printf("CMA"); break;
-            
-        case 0x30: printf("NOP"); break;
-        case 0x31: printf("LXI    SP,#$%02x%02x", code[2], code[1]); opbytes=3; break;
-        case 0x32: printf("STA    $%02x%02x", code[2], code[1]); opbytes=3; break;
-        case 0x33: printf("INX    SP"); break;
-        case 0x34: printf("INR    M"); break;
-        case 0x35: printf("DCR    M"); break;
-        case 0x36: printf("MVI    M,#$%02x", code[1]); opbytes=2; break;
-        case 0x37: printf("STC"); break;
-        case 0x38: printf("NOP"); break;
-        case 0x39: printf("DAD    SP"); break;
-        case 0x3a: printf("LDA    $%02x%02x", code[2], code[1]); opbytes=3; break;
-        case 0x3b: printf("DCX    SP"); break;
-        case 0x3c: printf("INR    A"); break;
-        case 0x3d: printf("DCR    A"); break;
-        case 0x3e: printf("MVI    A,#$%02x", code[1]); opbytes = 2; break;
-        case 0x3f: printf("CMC"); break;
-            
-        case 0x40: printf("MOV    B,B"); break;
-        case 0x41: printf("MOV    B,C"); break;
-        case 0x42: printf("MOV    B,D"); break;
-        case 0x43: printf("MOV    B,E"); break;
-        case 0x44: printf("MOV    B,H"); break;
-        case 0x45: printf("MOV    B,L"); break;
-        case 0x46: printf("MOV    B,M"); break;
-        case 0x47: printf("MOV    B,A"); break;
-        case 0x48: printf("MOV    C,B"); break;
-        case 0x49: printf("MOV    C,C"); break;
-        case 0x4a: printf("MOV    C,D"); break;
-        case 0x4b: printf("MOV    C,E"); break;
-        case 0x4c: printf("MOV    C,H"); break;
-        case 0x4d: printf("MOV    C,L"); break;
-        case 0x4e: printf("MOV    C,M"); break;
-        case 0x4f: printf("MOV    C,A"); break;
-            
-        case 0x50: printf("MOV    D,B"); break;
-        case 0x51: printf("MOV    D,C"); break;
-        case 0x52: printf("MOV    D,D"); break;
-        case 0x53: printf("MOV    D.E"); break;
-        case 0x54: printf("MOV    D,H"); break;
-        case 0x55: printf("MOV    D,L"); break;
-        case 0x56: printf("MOV    D,M"); break;
-        case 0x57: printf("MOV    D,A"); break;
-        case 0x58: printf("MOV    E,B"); break;
-        case 0x59: printf("MOV    E,C"); break;
-        case 0x5a: printf("MOV    E,D"); break;
-        case 0x5b: printf("MOV    E,E"); break;
-        case 0x5c: printf("MOV    E,H"); break;
-        case 0x5d: printf("MOV    E,L"); break;
-        case 0x5e: printf("MOV    E,M"); break;
-        case 0x5f: printf("MOV    E,A"); break;
-
-        case 0x60: printf("MOV    H,B"); break;
-        case 0x61: printf("MOV    H,C"); break;
-        case 0x62: printf("MOV    H,D"); break;
-        case 0x63: printf("MOV    H.E"); break;
-        case 0x64: printf("MOV    H,H"); break;
-        case 0x65: printf("MOV    H,L"); break;
-        case 0x66: printf("MOV    H,M"); break;
-        case 0x67: printf("MOV    H,A"); break;
-        case 0x68: printf("MOV    L,B"); break;
-        case 0x69: printf("MOV    L,C"); break;
-        case 0x6a: printf("MOV    L,D"); break;
-        case 0x6b: printf("MOV    L,E"); break;
-        case 0x6c: printf("MOV    L,H"); break;
-        case 0x6d: printf("MOV    L,L"); break;
-        case 0x6e: printf("MOV    L,M"); break;
-        case 0x6f: printf("MOV    L,A"); break;
-
-        case 0x70: printf("MOV    M,B"); break;
-        case 0x71: printf("MOV    M,C"); break;
-        case 0x72: printf("MOV    M,D"); break;
-        case 0x73: printf("MOV    M.E"); break;
-        case 0x74: printf("MOV    M,H"); break;
-        case 0x75: printf("MOV    M,L"); break;
-        case 0x76: printf("HLT");        break;
-        case 0x77: printf("MOV    M,A"); break;
-        case 0x78: printf("MOV    A,B"); break;
-        case 0x79: printf("MOV    A,C"); break;
-        case 0x7a: printf("MOV    A,D"); break;
-        case 0x7b: printf("MOV    A,E"); break;
-        case 0x7c: printf("MOV    A,H"); break;
-        case 0x7d: printf("MOV    A,L"); break;
-        case 0x7e: printf("MOV    A,M"); break;
-        case 0x7f: printf("MOV    A,A"); break;
-
-        case 0x80: printf("ADD    B"); break;
-        case 0x81: printf("ADD    C"); break;
-        case 0x82: printf("ADD    D"); break;
-        case 0x83: printf("ADD    E"); break;
-        case 0x84: printf("ADD    H"); break;
-        case 0x85: printf("ADD    L"); break;
-        case 0x86: printf("ADD    M"); break;
-        case 0x87: printf("ADD    A"); break;
-        case 0x88: printf("ADC    B"); break;
-        case 0x89: printf("ADC    C"); break;
-        case 0x8a: printf("ADC    D"); break;
-        case 0x8b: printf("ADC    E"); break;
-        case 0x8c: printf("ADC    H"); break;
-        case 0x8d: printf("ADC    L"); break;
-        case 0x8e: printf("ADC    M"); break;
-        case 0x8f: printf("ADC    A"); break;
-
-        case 0x90: printf("SUB    B"); break;
-        case 0x91: printf("SUB    C"); break;
-        case 0x92: printf("SUB    D"); break;
-        case 0x93: printf("SUB    E"); break;
-        case 0x94: printf("SUB    H"); break;
-        case 0x95: printf("SUB    L"); break;
-        case 0x96: printf("SUB    M"); break;
-        case 0x97: printf("SUB    A"); break;
-        case 0x98: printf("SBB    B"); break;
-        case 0x99: printf("SBB    C"); break;
-        case 0x9a: printf("SBB    D"); break;
-        case 0x9b: printf("SBB    E"); break;
-        case 0x9c: printf("SBB    H"); break;
-        case 0x9d: printf("SBB    L"); break;
-        case 0x9e: printf("SBB    M"); break;
-        case 0x9f: printf("SBB    A"); break;
-
-        case 0xa0: printf("ANA    B"); break;
-        case 0xa1: printf("ANA    C"); break;
-        case 0xa2: printf("ANA    D"); break;
-        case 0xa3: printf("ANA    E"); break;
-        case 0xa4: printf("ANA    H"); break;
-        case 0xa5: printf("ANA    L"); break;
-        case 0xa6: printf("ANA    M"); break;
-        case 0xa7: printf("ANA    A"); break;
-        case 0xa8: printf("XRA    B"); break;
-        case 0xa9: printf("XRA    C"); break;
-        case 0xaa: printf("XRA    D"); break;
-        case 0xab: printf("XRA    E"); break;
-        case 0xac: printf("XRA    H"); break;
-        case 0xad: printf("XRA    L"); break;
-        case 0xae: printf("XRA    M"); break;
-        case 0xaf: printf("XRA    A"); break;
-
-        case 0xb0: printf("ORA    B"); break;
-        case 0xb1: printf("ORA    C"); break;
-        case 0xb2: printf("ORA    D"); break;
-        case 0xb3: printf("ORA    E"); break;
-        case 0xb4: printf("ORA    H"); break;
-        case 0xb5: printf("ORA    L"); break;
-        case 0xb6: printf("ORA    M"); break;
-        case 0xb7: printf("ORA    A"); break;
-        case 0xb8: printf("CMP    B"); break;
-        case 0xb9: printf("CMP    C"); break;
-        case 0xba: printf("CMP    D"); break;
-        case 0xbb: printf("CMP    E"); break;
-        case 0xbc: printf("CMP    H"); break;
-        case 0xbd: printf("CMP    L"); break;
-        case 0xbe: printf("CMP    M"); break;
-        case 0xbf: printf("CMP    A"); break;
-
-        case 0xc0: printf("RNZ"); break;
-        case 0xc1: printf("POP    B"); break;
-        case 0xc2: printf("JNZ    $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xc3: printf("JMP    $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xc4: printf("CNZ    $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xc5: printf("PUSH   B"); break;
-        case 0xc6: printf("ADI    #$%02x",code[1]); opbytes = 2; break;
-        case 0xc7: printf("RST    0"); break;
-        case 0xc8: printf("RZ"); break;
-        case 0xc9: printf("RET"); break;
-        case 0xca: printf("JZ     $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xcb: printf("JMP    $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xcc: printf("CZ     $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xcd: printf("CALL   $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xce: printf("ACI    #$%02x",code[1]); opbytes = 2; break;
-        case 0xcf: printf("RST    1"); break;
-
-        case 0xd0: printf("RNC"); break;
-        case 0xd1: printf("POP    D"); break;
-        case 0xd2: printf("JNC    $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xd3: printf("OUT    #$%02x",code[1]); opbytes = 2; break;
-        case 0xd4: printf("CNC    $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xd5: printf("PUSH   D"); break;
-        case 0xd6: printf("SUI    #$%02x",code[1]); opbytes = 2; break;
-        case 0xd7: printf("RST    2"); break;
-        case 0xd8: printf("RC");  break;
-        case 0xd9: printf("RET"); break;
-        case 0xda: printf("JC     $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xdb: printf("IN     #$%02x",code[1]); opbytes = 2; break;
-        case 0xdc: printf("CC     $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xdd: printf("CALL   $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xde: printf("SBI    #$%02x",code[1]); opbytes = 2; break;
-        case 0xdf: printf("RST    3"); break;
-
-        case 0xe0: printf("RPO"); break;
-        case 0xe1: printf("POP    H"); break;
-        case 0xe2: printf("JPO    $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xe3: printf("XTHL");break;
-        case 0xe4: printf("CPO    $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xe5: printf("PUSH   H"); break;
-        case 0xe6: printf("ANI    #$%02x",code[1]); opbytes = 2; break;
-        case 0xe7: printf("RST    4"); break;
-        case 0xe8: printf("RPE"); break;
-        case 0xe9: printf("PCHL");break;
-        case 0xea: printf("JPE    $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xeb: printf("XCHG"); break;
-        case 0xec: printf("CPE     $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xed: printf("CALL   $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xee: printf("XRI    #$%02x",code[1]); opbytes = 2; break;
-        case 0xef: printf("RST    5"); break;
-
-        case 0xf0: printf("RP");  break;
-        case 0xf1: printf("POP    PSW"); break;
-        case 0xf2: printf("JP     $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xf3: printf("DI");  break;
-        case 0xf4: printf("CP     $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xf5: printf("PUSH   PSW"); break;
-        case 0xf6: printf("ORI    #$%02x",code[1]); opbytes = 2; break;
-        case 0xf7: printf("RST    6"); break;
-        case 0xf8: printf("RM");  break;
-        case 0xf9: printf("SPHL");break;
-        case 0xfa: printf("JM     $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xfb: printf("EI");  break;
-        case 0xfc: printf("CM     $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xfd: printf("CALL   $%02x%02x",code[2],code[1]); opbytes = 3; break;
-        case 0xfe: printf("CPI    #$%02x",code[1]); opbytes = 2; break;
-        case 0xff: printf("RST    7"); break;
-    }
-	printf("\n"); 
-    return opbytes;
-}
-
-int Emulator8080::Emulate8080Operation(State8080* state){
-    unsigned char *opcode = &state->memory[state->pc];
-	Disassemble8080Opcodes(state->memory, state->pc);
-	state->pc+=1;
-    switch(*opcode){
+// The body of every instruction lives in this one switch. The reference path
+// (Emulate8080Operation) calls it with the opcode read at runtime, while each
+// ExecuteOpcode<Op> handler calls it with a constant so the compiler folds the
+// switch down to a single case.
+inline __attribute__((always_inline)) void Emulator8080::ExecuteInstruction(State8080* state, uint8_t op, const unsigned char *opcode){
+    switch(op){
 		case 0x00: break; //NOP
 		case 0x01: //LXI    B,word
-                   state->c = opcode[1];
-                   state->b = opcode[2];
+                   state->bc = (opcode[2] << 8) | opcode[1];
                    state->pc += 2;
                    break;
-		case 0x02: NotImplementedInstruction(state); break;
-		case 0x03: NotImplementedInstruction(state); break;
-		case 0x04: NotImplementedInstruction(state); break;
-		case 0x05: {
-                uint8_t res = state->b - 1;
-                state->flags.z = (res == 0);
-                state->flags.s = (0x80 == (res & 0x80));
-                state->flags.p = Parity(res, 8);
-                state->b = res;
-                break;
-        }
+		case 0x02: WriteMemory(state, state->bc, state->a); break; //STAX B
+		case 0x03: state->bc++; break; //INX B
+		case 0x04: state->b = Increment(state, state->b); break; //INR B
+		case 0x05: state->b = Decrement(state, state->b); break; //DCR B
 		case 0x06: { //MVI	B,word
 				state->b = opcode[1];
 				state->pc += 1;
 				break;
         }
-		case 0x07: NotImplementedInstruction(state); break;
-		case 0x08: NotImplementedInstruction(state); break;
-		case 0x09: {
-			uint32_t hl = (state->h << 8) | state->l;
-			uint32_t bc = (state->b << 8) | state->c;
-			uint32_t res = hl + bc;
-			state->h = (res & 0xff00) >> 8;
-			state->l = res & 0xff;
-			state->flags.cy = ((res & 0xffff0000) > 0);
+		case 0x07: { //RLC
+			uint8_t x = state->a;
+			state->a = (x << 1) | (x >> 7);
+			SetCarry(state, x >> 7);
 			break;
-        }
-		case 0x0a: NotImplementedInstruction(state); break;
-		case 0x0b: NotImplementedInstruction(state); break;
-		case 0x0c: NotImplementedInstruction(state); break;
-		case 0x0d: {
-			uint8_t res = state->c - 1;
-			state->flags.z = (res == 0);
-			state->flags.s = (0x80 == (res & 0x80));
-			state->flags.p = Parity(res, 8);
-			state->c = res;
+		}
+		case 0x08: break; //NOP (undocumented)
+		case 0x09: { //DAD B
+			uint32_t res = state->hl + state->bc;
+			state->hl = res;
+			SetCarry(state, res > 0xffff);
 			break;
-        }
+		}
+		case 0x0a: state->a = ReadMemory(state, state->bc); break; //LDAX B
+		case 0x0b: state->bc--; break; //DCX B
+		case 0x0c: state->c = Increment(state, state->c); break; //INR C
+		case 0x0d: state->c = Decrement(state, state->c); break; //DCR C
 		case 0x0e: {
             state->c = opcode[1];
 			state->pc++;
@@ -341,124 +50,142 @@ int Emulator8080::Emulate8080Operation(State8080* state){
     	case 0x0f: { 
             uint8_t x = state->a;
             state->a = ((x & 1) << 7) | (x >> 1);
-            state->flags.cy = (1 == (x&1));
+            SetCarry(state, x & 1);
             break;
         }
-		case 0x10: NotImplementedInstruction(state); break;
+		case 0x10: break; //NOP (undocumented)
 		case 0x11: { //LXI D
-            state->e = opcode[1];
-            state->d = opcode[2];
+            state->de = (opcode[2] << 8) | opcode[1];
             state->pc += 2;
             break;
         }
-		case 0x12: NotImplementedInstruction(state); break;
-		case 0x13: {
-            state->e++;
-            if (state->e == 0)
-                state->d++;
-            break;	
-        }
-		case 0x14: NotImplementedInstruction(state); break;
-		case 0x15: NotImplementedInstruction(state); break;
-		case 0x16: NotImplementedInstruction(state); break;
-		case 0x17: NotImplementedInstruction(state); break;
-		case 0x18: NotImplementedInstruction(state); break;
-		case 0x19: {
-			uint32_t hl = (state->h << 8) | state->l;
-			uint32_t de = (state->d << 8) | state->e;
-			uint32_t res = hl + de;
-			state->h = (res & 0xff00) >> 8;
-			state->l = res & 0xff;
-			state->flags.cy = ((res & 0xffff0000) != 0);
+		case 0x12: WriteMemory(state, state->de, state->a); break; //STAX D
+		case 0x13: state->de++; break; //INX D
+		case 0x14: state->d = Increment(state, state->d); break; //INR D
+		case 0x15: state->d = Decrement(state, state->d); break; //DCR D
+		case 0x16: state->d = opcode[1]; state->pc++; break; //MVI D,byte
+		case 0x17: { //RAL
+			uint8_t x = state->a;
+			state->a = (x << 1) | Carry(state);
+			SetCarry(state, x >> 7);
 			break;
-        }
+		}
+		case 0x18: break; //NOP (undocumented)
+		case 0x19: { //DAD D
+			uint32_t res = state->hl + state->de;
+			state->hl = res;
+			SetCarry(state, res > 0xffff);
+			break;
+		}
 		case 0x1a:{ //LDAX D
-            uint16_t offset = (state->d << 8) | state->e;
-            state->a = state->memory[offset];
+            uint16_t offset = state->de;
+            state->a = ReadMemory(state, offset);
             break;
         }
-		case 0x1b: NotImplementedInstruction(state); break;
-		case 0x1c: NotImplementedInstruction(state); break;
-		case 0x1d: NotImplementedInstruction(state); break;
-		case 0x1e: NotImplementedInstruction(state); break;
-		case 0x1f: NotImplementedInstruction(state); break;
-		case 0x20: NotImplementedInstruction(state); break;
+		case 0x1b: state->de--; break; //DCX D
+		case 0x1c: state->e = Increment(state, state->e); break; //INR E
+		case 0x1d: state->e = Decrement(state, state->e); break; //DCR E
+		case 0x1e: state->e = opcode[1]; state->pc++; break; //MVI E,byte
+		case 0x1f: { //RAR
+			uint8_t x = state->a;
+			state->a = (x >> 1) | (Carry(state) << 7);
+			SetCarry(state, x & 1);
+			break;
+		}
+		case 0x20: break; //NOP (undocumented)
 		case 0x21: //LXI H
-            state->l = opcode[1];
-            state->h = opcode[2];
+            state->hl = (opcode[2] << 8) | opcode[1];
             state->pc += 2;
             break;
-		case 0x22: NotImplementedInstruction(state); break;
-		case 0x23: { // INX H
-            state->l++;
-            if (state->l == 0)
-                state->h++;
-            break;
-        }
-		case 0x24: NotImplementedInstruction(state); break;
-		case 0x25: NotImplementedInstruction(state); break;
+		case 0x22: { //SHLD adr
+			uint16_t offset = (opcode[2] << 8) | opcode[1];
+			WriteMemory(state, offset, state->l);
+			WriteMemory(state, offset + 1, state->h);
+			state->pc += 2;
+			break;
+		}
+		case 0x23: state->hl++; break; // INX H
+		case 0x24: state->h = Increment(state, state->h); break; //INR H
+		case 0x25: state->h = Decrement(state, state->h); break; //DCR H
 		case 0x26: {
             state->h = opcode[1];
 			state->pc++;
 			break;
         }
-		case 0x27: NotImplementedInstruction(state); break;
-		case 0x28: NotImplementedInstruction(state); break;
-		case 0x29: {
-			uint32_t hl = (state->h << 8) | state->l;
-			uint32_t res = hl + hl;
-			state->h = (res & 0xff00) >> 8;
-			state->l = res & 0xff;
-			state->flags.cy = ((res & 0xffff0000) != 0);
+		case 0x27: DecimalAdjust(state); break; //DAA
+		case 0x28: break; //NOP (undocumented)
+		case 0x29: { //DAD H
+			uint32_t res = state->hl + state->hl;
+			state->hl = res;
+			SetCarry(state, res > 0xffff);
 			break;
-        }
-		case 0x2a: NotImplementedInstruction(state); break;
-		case 0x2b: NotImplementedInstruction(state); break;
-		case 0x2c: NotImplementedInstruction(state); break;
-		case 0x2d: NotImplementedInstruction(state); break;
-		case 0x2e: NotImplementedInstruction(state); break;
+		}
+		case 0x2a: { //LHLD adr
+			uint16_t offset = (opcode[2] << 8) | opcode[1];
+			state->l = ReadMemory(state, offset);
+			state->h = ReadMemory(state, (uint16_t)(offset + 1));
+			state->pc += 2;
+			break;
+		}
+		case 0x2b: state->hl--; break; //DCX H
+		case 0x2c: state->l = Increment(state, state->l); break; //INR L
+		case 0x2d: state->l = Decrement(state, state->l); break; //DCR L
+		case 0x2e: state->l = opcode[1]; state->pc++; break; //MVI L,byte
 		case 0x2f: // CMA (not)
 			state->a = ~state->a;
 			break;
-		case 0x30: NotImplementedInstruction(state); break;
+		case 0x30: break; //NOP (undocumented)
 		case 0x31: // LXI SP,word
 			state->sp = (opcode[2] << 8 | opcode[1]);
 			state->pc += 2;
 			break;
 		case 0x32: {
             uint16_t offset = (opcode[2]<<8) | (opcode[1]);
-			state->memory[offset] = state->a;
+			WriteMemory(state, offset, state->a);
 			state->pc += 2;
             break;
         }
-		case 0x33: NotImplementedInstruction(state); break;
-		case 0x34: NotImplementedInstruction(state); break;
-		case 0x35: NotImplementedInstruction(state); break;
+		case 0x33: state->sp++; break; //INX SP
+		case 0x34: { //INR M
+			uint16_t offset = state->hl;
+			WriteMemory(state, offset, Increment(state, ReadMemory(state, offset)));
+			break;
+		}
+		case 0x35: { //DCR M
+			uint16_t offset = state->hl;
+			WriteMemory(state, offset, Decrement(state, ReadMemory(state, offset)));
+			break;
+		}
 		case 0x36: {
-            uint16_t offset = (state->h<<8) | state->l;
-			state->memory[offset] = opcode[1];
+            uint16_t offset = state->hl;
+			WriteMemory(state, offset, opcode[1]);
 			state->pc++;
             break;
         } 
-		case 0x37: NotImplementedInstruction(state); break;
-		case 0x38: NotImplementedInstruction(state); break;
-		case 0x39: NotImplementedInstruction(state); break;
+		case 0x37: SetCarry(state, true); break; //STC
+		case 0x38: break; //NOP (undocumented)
+		case 0x39: { //DAD SP
+			uint32_t res = state->hl + state->sp;
+			state->hl = res;
+			SetCarry(state, res > 0xffff);
+			break;
+		}
 		case 0x3a: {
             uint16_t offset = (opcode[2]<<8) | (opcode[1]);
-			state->a = state->memory[offset];
+			state->a = ReadMemory(state, offset);
 			state->pc+=2;
             break;
         }
-		case 0x3b: NotImplementedInstruction(state); break;
-		case 0x3c: NotImplementedInstruction(state); break;
-		case 0x3d: NotImplementedInstruction(state); break;
+		case 0x3b: state->sp--; break; //DCX SP
+		case 0x3c: state->a = Increment(state, state->a); break; //INR A
+		case 0x3d: state->a = Decrement(state, state->a); break; //DCR A
 		case 0x3e: {
             state->a = opcode[1];
 			state->pc++;
             break;
         }
-		case 0x3f: NotImplementedInstruction(state); break;
-		case 0x40: NotImplementedInstruction(state); break;
+		case 0x3f: SetCarry(state, !Carry(state)); break; //CMC
+		case 0x40: state->b = state->b; break; //MOV B,B
 		case 0x41: 
                    state->b = state->c; //MOV B,C
                    break;
@@ -468,79 +195,79 @@ int Emulator8080::Emulate8080Operation(State8080* state){
 		case 0x43: 
                    state->b = state->e; //MOV B,E
                    break;
-		case 0x44: NotImplementedInstruction(state); break;
-		case 0x45: NotImplementedInstruction(state); break;
-		case 0x46: NotImplementedInstruction(state); break;
-		case 0x47: NotImplementedInstruction(state); break;
-		case 0x48: NotImplementedInstruction(state); break;
-		case 0x49: NotImplementedInstruction(state); break;
-		case 0x4a: NotImplementedInstruction(state); break;
-		case 0x4b: NotImplementedInstruction(state); break;
-		case 0x4c: NotImplementedInstruction(state); break;
-		case 0x4d: NotImplementedInstruction(state); break;
-		case 0x4e: NotImplementedInstruction(state); break;
-		case 0x4f: NotImplementedInstruction(state); break;
-		case 0x50: NotImplementedInstruction(state); break;
-		case 0x51: NotImplementedInstruction(state); break;
-		case 0x52: NotImplementedInstruction(state); break;
-		case 0x53: NotImplementedInstruction(state); break;
-		case 0x54: NotImplementedInstruction(state); break;
-		case 0x55: NotImplementedInstruction(state); break;
+		case 0x44: state->b = state->h; break; //MOV B,H
+		case 0x45: state->b = state->l; break; //MOV B,L
+		case 0x46: state->b = ReadMemory(state, state->hl); break; //MOV B,M
+		case 0x47: state->b = state->a; break; //MOV B,A
+		case 0x48: state->c = state->b; break; //MOV C,B
+		case 0x49: state->c = state->c; break; //MOV C,C
+		case 0x4a: state->c = state->d; break; //MOV C,D
+		case 0x4b: state->c = state->e; break; //MOV C,E
+		case 0x4c: state->c = state->h; break; //MOV C,H
+		case 0x4d: state->c = state->l; break; //MOV C,L
+		case 0x4e: state->c = ReadMemory(state, state->hl); break; //MOV C,M
+		case 0x4f: state->c = state->a; break; //MOV C,A
+		case 0x50: state->d = state->b; break; //MOV D,B
+		case 0x51: state->d = state->c; break; //MOV D,C
+		case 0x52: state->d = state->d; break; //MOV D,D
+		case 0x53: state->d = state->e; break; //MOV D,E
+		case 0x54: state->d = state->h; break; //MOV D,H
+		case 0x55: state->d = state->l; break; //MOV D,L
 		case 0x56: {
-            uint16_t offset = (state->h<<8) | (state->l);
-			state->d = state->memory[offset];
+            uint16_t offset = state->hl;
+			state->d = ReadMemory(state, offset);
             break;
         }
-		case 0x57: NotImplementedInstruction(state); break;
-		case 0x58: NotImplementedInstruction(state); break;
-		case 0x59: NotImplementedInstruction(state); break;
-		case 0x5a: NotImplementedInstruction(state); break;
-		case 0x5b: NotImplementedInstruction(state); break;
-		case 0x5c: NotImplementedInstruction(state); break;
-		case 0x5d: NotImplementedInstruction(state); break;
+		case 0x57: state->d = state->a; break; //MOV D,A
+		case 0x58: state->e = state->b; break; //MOV E,B
+		case 0x59: state->e = state->c; break; //MOV E,C
+		case 0x5a: state->e = state->d; break; //MOV E,D
+		case 0x5b: state->e = state->e; break; //MOV E,E
+		case 0x5c: state->e = state->h; break; //MOV E,H
+		case 0x5d: state->e = state->l; break; //MOV E,L
 		case 0x5e: {
-            uint16_t offset = (state->h<<8) | (state->l);
-			state->e = state->memory[offset];
+            uint16_t offset = state->hl;
+			state->e = ReadMemory(state, offset);
             break;
         }
-		case 0x5f: NotImplementedInstruction(state); break;
-		case 0x60: NotImplementedInstruction(state); break;
-		case 0x61: NotImplementedInstruction(state); break;
-		case 0x62: NotImplementedInstruction(state); break;
-		case 0x63: NotImplementedInstruction(state); break;
-		case 0x64: NotImplementedInstruction(state); break;
-		case 0x65: NotImplementedInstruction(state); break;
+		case 0x5f: state->e = state->a; break; //MOV E,A
+		case 0x60: state->h = state->b; break; //MOV H,B
+		case 0x61: state->h = state->c; break; //MOV H,C
+		case 0x62: state->h = state->d; break; //MOV H,D
+		case 0x63: state->h = state->e; break; //MOV H,E
+		case 0x64: state->h = state->h; break; //MOV H,H
+		case 0x65: state->h = state->l; break; //MOV H,L
 		case 0x66: {
-            uint16_t offset = (state->h<<8) | (state->l);
-			state->h = state->memory[offset];
+            uint16_t offset = state->hl;
+			state->h = ReadMemory(state, offset);
             break;
         }
-		case 0x67: NotImplementedInstruction(state); break;
-		case 0x68: NotImplementedInstruction(state); break;
-		case 0x69: NotImplementedInstruction(state); break;
-		case 0x6a: NotImplementedInstruction(state); break;
-		case 0x6b: NotImplementedInstruction(state); break;
-		case 0x6c: NotImplementedInstruction(state); break;
-		case 0x6d: NotImplementedInstruction(state); break;
-		case 0x6e: NotImplementedInstruction(state); break;
+		case 0x67: state->h = state->a; break; //MOV H,A
+		case 0x68: state->l = state->b; break; //MOV L,B
+		case 0x69: state->l = state->c; break; //MOV L,C
+		case 0x6a: state->l = state->d; break; //MOV L,D
+		case 0x6b: state->l = state->e; break; //MOV L,E
+		case 0x6c: state->l = state->h; break; //MOV L,H
+		case 0x6d: state->l = state->l; break; //MOV L,L
+		case 0x6e: state->l = ReadMemory(state, state->hl); break; //MOV L,M
 		case 0x6f: {
             state->l = state->a;
             break;
         }
-		case 0x70: NotImplementedInstruction(state); break;
-		case 0x71: NotImplementedInstruction(state); break;
-		case 0x72: NotImplementedInstruction(state); break;
-		case 0x73: NotImplementedInstruction(state); break;
-		case 0x74: NotImplementedInstruction(state); break;
-		case 0x75: NotImplementedInstruction(state); break;
-		case 0x76: NotImplementedInstruction(state); break;
+		case 0x70: WriteMemory(state, state->hl, state->b); break; //MOV M,B
+		case 0x71: WriteMemory(state, state->hl, state->c); break; //MOV M,C
+		case 0x72: WriteMemory(state, state->hl, state->d); break; //MOV M,D
+		case 0x73: WriteMemory(state, state->hl, state->e); break; //MOV M,E
+		case 0x74: WriteMemory(state, state->hl, state->h); break; //MOV M,H
+		case 0x75: WriteMemory(state, state->hl, state->l); break; //MOV M,L
+		case 0x76: state->halted = 1; break; //HLT
 		case 0x77: {
-            uint16_t offset = (state->h << 8) | (state->l);
-            state->memory[offset] = state->a;
+            uint16_t offset = state->hl;
+            WriteMemory(state, offset, state->a);
             break;
         }
-		case 0x78: NotImplementedInstruction(state); break;
-		case 0x79: NotImplementedInstruction(state); break;
+		case 0x78: state->a = state->b; break; //MOV A,B
+		case 0x79: state->a = state->c; break; //MOV A,C
 		case 0x7a: {
             state->a  = state->d;
             break;
@@ -553,289 +280,534 @@ int Emulator8080::Emulate8080Operation(State8080* state){
             state->a  = state->h;
             break;
         }
-		case 0x7d: NotImplementedInstruction(state); break;
+		case 0x7d: state->a = state->l; break; //MOV A,L
 		case 0x7e: {
-            uint16_t offset = (state->h<<8) | (state->l);
-            state->a = state->memory[offset];
+            uint16_t offset = state->hl;
+            state->a = ReadMemory(state, offset);
             break;
         }
-		case 0x7f: NotImplementedInstruction(state); break;
-		case 0x80: { //ADD B
-				uint16_t answer = (uint16_t) state->a + (uint16_t) state->b;
-				state->flags.z = ((answer & 0xff) == 0);
-				state->flags.s = ((answer & 0x80) != 0); //MSB (Most significant bit)    
-				state->flags.cy = (answer > 0xff);
-				//state->flags.p = Parity(answer&0xff);    
-				state->a = answer & 0xff;  
-				break;  
-		}
-		case 0x81: { //ADD C
-				uint16_t answer = (uint16_t) state->a + (uint16_t) state->c;    
-				state->flags.z = ((answer & 0xff) == 0);    
-				state->flags.s = ((answer & 0x80) != 0);    
-				state->flags.cy = (answer > 0xff);
-				//state->flags.p = Parity(answer&0xff);    
-				state->a = answer & 0xff;  
-				break;  
-		}
-		case 0x82: NotImplementedInstruction(state); break;
-		case 0x83: NotImplementedInstruction(state); break;
-		case 0x84: NotImplementedInstruction(state); break;
-		case 0x85: NotImplementedInstruction(state); break;
-		case 0x86: {
-				uint16_t offset = (state->h<<8) | (state->l);    
-				uint16_t answer = (uint16_t) state->a + state->memory[offset];    
-				state->flags.z = ((answer & 0xff) == 0);    
-				state->flags.s = ((answer & 0x80) != 0);    
-				state->flags.cy = (answer > 0xff);    
-				//state->flags.p = Parity(answer&0xff);    
-				state->a = answer & 0xff;  
-				break;  
+		case 0x7f: state->a = state->a; break; //MOV A,A
+		case 0x80: state->a = Add(state, state->a, state->b, 0); break; //ADD B
+		case 0x81: state->a = Add(state, state->a, state->c, 0); break; //ADD C
+		case 0x82: state->a = Add(state, state->a, state->d, 0); break; //ADD D
+		case 0x83: state->a = Add(state, state->a, state->e, 0); break; //ADD E
+		case 0x84: state->a = Add(state, state->a, state->h, 0); break; //ADD H
+		case 0x85: state->a = Add(state, state->a, state->l, 0); break; //ADD L
+		case 0x86: { //ADD M
+				uint16_t offset = state->hl;
+				state->a = Add(state, state->a, ReadMemory(state, offset), 0);
+				break;
 		}
-		case 0x87: NotImplementedInstruction(state); break;
-		case 0x88: NotImplementedInstruction(state); break;
-		case 0x89: NotImplementedInstruction(state); break;
-		case 0x8a: NotImplementedInstruction(state); break;
-		case 0x8b: NotImplementedInstruction(state); break;
-		case 0x8c: NotImplementedInstruction(state); break;
-		case 0x8d: NotImplementedInstruction(state); break;
-		case 0x8e: NotImplementedInstruction(state); break;
-		case 0x8f: NotImplementedInstruction(state); break;
-		case 0x90: NotImplementedInstruction(state); break;
-		case 0x91: NotImplementedInstruction(state); break;
-		case 0x92: NotImplementedInstruction(state); break;
-		case 0x93: NotImplementedInstruction(state); break;
-		case 0x94: NotImplementedInstruction(state); break;
-		case 0x95: NotImplementedInstruction(state); break;
-		case 0x96: NotImplementedInstruction(state); break;
-		case 0x97: NotImplementedInstruction(state); break;
-		case 0x98: NotImplementedInstruction(state); break;
-		case 0x99: NotImplementedInstruction(state); break;
-		case 0x9a: NotImplementedInstruction(state); break;
-		case 0x9b: NotImplementedInstruction(state); break;
-		case 0x9c: NotImplementedInstruction(state); break;
-		case 0x9d: NotImplementedInstruction(state); break;
-		case 0x9e: NotImplementedInstruction(state); break;
-		case 0x9f: NotImplementedInstruction(state); break;
-		case 0xa0: NotImplementedInstruction(state); break;
-		case 0xa1: NotImplementedInstruction(state); break;
-		case 0xa2: NotImplementedInstruction(state); break;
-		case 0xa3: NotImplementedInstruction(state); break;
-		case 0xa4: NotImplementedInstruction(state); break;
-		case 0xa5: NotImplementedInstruction(state); break;
-		case 0xa6: NotImplementedInstruction(state); break;
-		case 0xa7: {
-           state->a = state->a & state->a;
-           state->flags.cy = state->flags.ac = 0;
-           state->flags.z = (state->a == 0);
-           state->flags.s = (0x80 == (state->a & 0x80));
-           state->flags.p = Parity(state->a, 8);
-           break;
-        }
-		case 0xa8: NotImplementedInstruction(state); break;
-		case 0xa9: NotImplementedInstruction(state); break;
-		case 0xaa: NotImplementedInstruction(state); break;
-		case 0xab: NotImplementedInstruction(state); break;
-		case 0xac: NotImplementedInstruction(state); break;
-		case 0xad: NotImplementedInstruction(state); break;
-		case 0xae: NotImplementedInstruction(state); break;
-		case 0xaf: {
-           state->a = state->a ^ state->a;
-           state->flags.cy = state->flags.ac = 0;
-           state->flags.z = (state->a == 0);
-           state->flags.s = (0x80 == (state->a & 0x80));
-           state->flags.p = Parity(state->a, 8);
-           break;
-        }
-		case 0xb0: NotImplementedInstruction(state); break;
-		case 0xb1: NotImplementedInstruction(state); break;
-		case 0xb2: NotImplementedInstruction(state); break;
-		case 0xb3: NotImplementedInstruction(state); break;
-		case 0xb4: NotImplementedInstruction(state); break;
-		case 0xb5: NotImplementedInstruction(state); break;
-		case 0xb6: NotImplementedInstruction(state); break;
-		case 0xb7: NotImplementedInstruction(state); break;
-		case 0xb8: NotImplementedInstruction(state); break;
-		case 0xb9: NotImplementedInstruction(state); break;
-		case 0xba: NotImplementedInstruction(state); break;
-		case 0xbb: NotImplementedInstruction(state); break;
-		case 0xbc: NotImplementedInstruction(state); break;
-		case 0xbd: NotImplementedInstruction(state); break;
-		case 0xbe: NotImplementedInstruction(state); break;
-		case 0xbf: NotImplementedInstruction(state); break;
-		case 0xc0: NotImplementedInstruction(state); break;
+		case 0x87: state->a = Add(state, state->a, state->a, 0); break; //ADD A
+		case 0x88: state->a = Add(state, state->a, state->b, Carry(state)); break; //ADC B
+		case 0x89: state->a = Add(state, state->a, state->c, Carry(state)); break; //ADC C
+		case 0x8a: state->a = Add(state, state->a, state->d, Carry(state)); break; //ADC D
+		case 0x8b: state->a = Add(state, state->a, state->e, Carry(state)); break; //ADC E
+		case 0x8c: state->a = Add(state, state->a, state->h, Carry(state)); break; //ADC H
+		case 0x8d: state->a = Add(state, state->a, state->l, Carry(state)); break; //ADC L
+		case 0x8e: state->a = Add(state, state->a, ReadMemory(state, state->hl), Carry(state)); break; //ADC M
+		case 0x8f: state->a = Add(state, state->a, state->a, Carry(state)); break; //ADC A
+		case 0x90: state->a = Subtract(state, state->a, state->b, 0); break; //SUB B
+		case 0x91: state->a = Subtract(state, state->a, state->c, 0); break; //SUB C
+		case 0x92: state->a = Subtract(state, state->a, state->d, 0); break; //SUB D
+		case 0x93: state->a = Subtract(state, state->a, state->e, 0); break; //SUB E
+		case 0x94: state->a = Subtract(state, state->a, state->h, 0); break; //SUB H
+		case 0x95: state->a = Subtract(state, state->a, state->l, 0); break; //SUB L
+		case 0x96: state->a = Subtract(state, state->a, ReadMemory(state, state->hl), 0); break; //SUB M
+		case 0x97: state->a = Subtract(state, state->a, state->a, 0); break; //SUB A
+		case 0x98: state->a = Subtract(state, state->a, state->b, Carry(state)); break; //SBB B
+		case 0x99: state->a = Subtract(state, state->a, state->c, Carry(state)); break; //SBB C
+		case 0x9a: state->a = Subtract(state, state->a, state->d, Carry(state)); break; //SBB D
+		case 0x9b: state->a = Subtract(state, state->a, state->e, Carry(state)); break; //SBB E
+		case 0x9c: state->a = Subtract(state, state->a, state->h, Carry(state)); break; //SBB H
+		case 0x9d: state->a = Subtract(state, state->a, state->l, Carry(state)); break; //SBB L
+		case 0x9e: state->a = Subtract(state, state->a, ReadMemory(state, state->hl), Carry(state)); break; //SBB M
+		case 0x9f: state->a = Subtract(state, state->a, state->a, Carry(state)); break; //SBB A
+		case 0xa0: state->a = And(state, state->a, state->b); break; //ANA B
+		case 0xa1: state->a = And(state, state->a, state->c); break; //ANA C
+		case 0xa2: state->a = And(state, state->a, state->d); break; //ANA D
+		case 0xa3: state->a = And(state, state->a, state->e); break; //ANA E
+		case 0xa4: state->a = And(state, state->a, state->h); break; //ANA H
+		case 0xa5: state->a = And(state, state->a, state->l); break; //ANA L
+		case 0xa6: state->a = And(state, state->a, ReadMemory(state, state->hl)); break; //ANA M
+		case 0xa7: state->a = And(state, state->a, state->a); break; //ANA A
+		case 0xa8: state->a = Xor(state, state->a, state->b); break; //XRA B
+		case 0xa9: state->a = Xor(state, state->a, state->c); break; //XRA C
+		case 0xaa: state->a = Xor(state, state->a, state->d); break; //XRA D
+		case 0xab: state->a = Xor(state, state->a, state->e); break; //XRA E
+		case 0xac: state->a = Xor(state, state->a, state->h); break; //XRA H
+		case 0xad: state->a = Xor(state, state->a, state->l); break; //XRA L
+		case 0xae: state->a = Xor(state, state->a, ReadMemory(state, state->hl)); break; //XRA M
+		case 0xaf: state->a = Xor(state, state->a, state->a); break; //XRA A
+		case 0xb0: state->a = Or(state, state->a, state->b); break; //ORA B
+		case 0xb1: state->a = Or(state, state->a, state->c); break; //ORA C
+		case 0xb2: state->a = Or(state, state->a, state->d); break; //ORA D
+		case 0xb3: state->a = Or(state, state->a, state->e); break; //ORA E
+		case 0xb4: state->a = Or(state, state->a, state->h); break; //ORA H
+		case 0xb5: state->a = Or(state, state->a, state->l); break; //ORA L
+		case 0xb6: state->a = Or(state, state->a, ReadMemory(state, state->hl)); break; //ORA M
+		case 0xb7: state->a = Or(state, state->a, state->a); break; //ORA A
+		case 0xb8: Subtract(state, state->a, state->b, 0); break; //CMP B
+		case 0xb9: Subtract(state, state->a, state->c, 0); break; //CMP C
+		case 0xba: Subtract(state, state->a, state->d, 0); break; //CMP D
+		case 0xbb: Subtract(state, state->a, state->e, 0); break; //CMP E
+		case 0xbc: Subtract(state, state->a, state->h, 0); break; //CMP H
+		case 0xbd: Subtract(state, state->a, state->l, 0); break; //CMP L
+		case 0xbe: Subtract(state, state->a, ReadMemory(state, state->hl), 0); break; //CMP M
+		case 0xbf: Subtract(state, state->a, state->a, 0); break; //CMP A
+		case 0xc0: ConditionalReturn(state, !Zero(state)); break; // RNZ
 		case 0xc1: {
-            state->c = state->memory[state->sp];
-            state->b = state->memory[state->sp+1];
+            state->c = ReadMemory(state, state->sp);
+            state->b = ReadMemory(state, state->sp+1);
             state->sp += 2;
 			break;
         }
-		case 0xc2: // JNZ
-			if(state->flags.z == 0)
-				state->pc = (opcode[2] << 8) | opcode[1];
-			else
-                state->pc += 2;	
-			break;
+		case 0xc2: ConditionalJump(state, opcode, !Zero(state)); break; // JNZ
 		case 0xc3: // JMP
 			state->pc = (opcode[2] << 8) | opcode[1];
 			break;
-		case 0xc4: NotImplementedInstruction(state); break;
+		case 0xc4: ConditionalCall(state, opcode, !Zero(state)); break; // CNZ
 		case 0xc5: {
-			state->memory[state->sp-1] = state->b;
-			state->memory[state->sp-2] = state->c;
+			WriteMemory(state, state->sp-1, state->b);
+			WriteMemory(state, state->sp-2, state->c);
 			state->sp = state->sp - 2;
 			break;
         }
 		case 0xc6: {
-			uint16_t answer = (uint16_t) state->a + (uint16_t) opcode[1];    
-            state->flags.z = ((answer & 0xff) == 0);    
-            state->flags.s = ((answer & 0x80) != 0);    
-            state->flags.cy = (answer > 0xff);    
-            state->flags.p = Parity((answer&0xff), 8);
-            state->a = (uint8_t)answer;   
+            state->a = Add(state, state->a, opcode[1], 0); //ADI byte
             state->pc += 1;
             break;  
 		}	
-		case 0xc7: NotImplementedInstruction(state); break;
-		case 0xc8: NotImplementedInstruction(state); break;
+		case 0xc7: Restart(state, 0x00); break; // RST 0
+		case 0xc8: ConditionalReturn(state, Zero(state)); break; // RZ
 		case 0xc9: { // RET
-			state->pc = state->memory[state->sp] | (state->memory[state->sp+1] << 8);    
+			state->pc = ReadMemory(state, state->sp) | (ReadMemory(state, state->sp+1) << 8);    
             state->sp += 2;    
             break;  
 		}
-		case 0xca: NotImplementedInstruction(state); break;
-		case 0xcb: NotImplementedInstruction(state); break;
-		case 0xcc: NotImplementedInstruction(state); break;
+		case 0xca: ConditionalJump(state, opcode, Zero(state)); break; // JZ
+		case 0xcb: ConditionalJump(state, opcode, true); break; // JMP (undocumented)
+		case 0xcc: ConditionalCall(state, opcode, Zero(state)); break; // CZ
 		case 0xcd: { // CALL address
+			uint16_t    target = (opcode[2] << 8) | opcode[1];
 			uint16_t    ret = state->pc+2;    
-            state->memory[state->sp-1] = (ret >> 8) & 0xff;    
-            state->memory[state->sp-2] = (ret & 0xff);    
+            WriteMemory(state, state->sp-1, (ret >> 8) & 0xff);
+            WriteMemory(state, state->sp-2, (ret & 0xff));
             state->sp = state->sp - 2;    
-            state->pc = (opcode[2] << 8) | opcode[1];
+            state->pc = target;
 			break;
 		}
-		case 0xce: NotImplementedInstruction(state); break;
-		case 0xcf: NotImplementedInstruction(state); break;
-		case 0xd0: NotImplementedInstruction(state); break;
+		case 0xce: state->a = Add(state, state->a, opcode[1], Carry(state)); state->pc++; break; //ACI byte
+		case 0xcf: Restart(state, 0x08); break; // RST 1
+		case 0xd0: ConditionalReturn(state, !Carry(state)); break; // RNC
 		case 0xd1: {
-            state->e = state->memory[state->sp];
-            state->d = state->memory[state->sp+1];
+            state->e = ReadMemory(state, state->sp);
+            state->d = ReadMemory(state, state->sp+1);
             state->sp += 2;
             break;
         }
-		case 0xd2: NotImplementedInstruction(state); break;
-		case 0xd3: {
+		case 0xd2: ConditionalJump(state, opcode, !Carry(state)); break; // JNC
+		case 0xd3: { //OUT byte
+			io.Out(opcode[1], state->a);
 			state->pc++;
 			break;
         }
-		case 0xd4: NotImplementedInstruction(state); break;
+		case 0xd4: ConditionalCall(state, opcode, !Carry(state)); break; // CNC
 		case 0xd5: {
-			state->memory[state->sp-1] = state->d;
-			state->memory[state->sp-2] = state->e;
+			WriteMemory(state, state->sp-1, state->d);
+			WriteMemory(state, state->sp-2, state->e);
 			state->sp = state->sp - 2;
             break;
         }
-		case 0xd6: NotImplementedInstruction(state); break;
-		case 0xd7: NotImplementedInstruction(state); break;
-		case 0xd8: NotImplementedInstruction(state); break;
-		case 0xd9: NotImplementedInstruction(state); break;
-		case 0xda: NotImplementedInstruction(state); break;
-		case 0xdb: NotImplementedInstruction(state); break;
-		case 0xdc: NotImplementedInstruction(state); break;
-		case 0xdd: NotImplementedInstruction(state); break;
-		case 0xde: NotImplementedInstruction(state); break;
-		case 0xdf: NotImplementedInstruction(state); break;
-		case 0xe0: NotImplementedInstruction(state); break;
+		case 0xd6: state->a = Subtract(state, state->a, opcode[1], 0); state->pc++; break; //SUI byte
+		case 0xd7: Restart(state, 0x10); break; // RST 2
+		case 0xd8: ConditionalReturn(state, Carry(state)); break; // RC
+		case 0xd9: { // RET (undocumented)
+			state->pc = ReadMemory(state, state->sp) | (ReadMemory(state, (uint16_t)(state->sp+1)) << 8);
+			state->sp += 2;
+			break;
+		}
+		case 0xda: ConditionalJump(state, opcode, Carry(state)); break; // JC
+		case 0xdb: { //IN byte
+			state->a = io.In(opcode[1]);
+			state->pc++;
+			break;
+		}
+		case 0xdc: ConditionalCall(state, opcode, Carry(state)); break; // CC
+		case 0xdd: { // CALL address (undocumented)
+			uint16_t target = (opcode[2] << 8) | opcode[1];
+			uint16_t ret = state->pc+2;
+			WriteMemory(state, state->sp-1, (ret >> 8) & 0xff);
+			WriteMemory(state, state->sp-2, (ret & 0xff));
+			state->sp = state->sp - 2;
+			state->pc = target;
+			break;
+		}
+		case 0xde: state->a = Subtract(state, state->a, opcode[1], Carry(state)); state->pc++; break; //SBI byte
+		case 0xdf: Restart(state, 0x18); break; // RST 3
+		case 0xe0: ConditionalReturn(state, !ParityEven(state)); break; // RPO
 		case 0xe1: {
-            state->l = state->memory[state->sp];
-            state->h = state->memory[state->sp+1];
+            state->l = ReadMemory(state, state->sp);
+            state->h = ReadMemory(state, state->sp+1);
             state->sp += 2;
 			break;
         }
-		case 0xe2: NotImplementedInstruction(state); break;
-		case 0xe3: NotImplementedInstruction(state); break;
-		case 0xe4: NotImplementedInstruction(state); break;
+		case 0xe2: ConditionalJump(state, opcode, !ParityEven(state)); break; // JPO
+		case 0xe3: { //XTHL
+			uint8_t l = state->l;
+			uint8_t h = state->h;
+			state->l = ReadMemory(state, state->sp);
+			state->h = ReadMemory(state, (uint16_t)(state->sp+1));
+			WriteMemory(state, state->sp, l);
+			WriteMemory(state, state->sp+1, h);
+			break;
+		}
+		case 0xe4: ConditionalCall(state, opcode, !ParityEven(state)); break; // CPO
 		case 0xe5: {
-			state->memory[state->sp-1] = state->h;
-			state->memory[state->sp-2] = state->l;
+			WriteMemory(state, state->sp-1, state->h);
+			WriteMemory(state, state->sp-2, state->l);
 			state->sp = state->sp - 2;
 			break;
         }
 		case 0xe6: { //ANI byte
-            state->a = state->a & opcode[1];
-            state->flags.cy = state->flags.ac = 0;
-            state->flags.z = (state->a == 0);
-            state->flags.s = (0x80 == (state->a & 0x80));
-            state->flags.p = Parity(state->a, 8);
+            state->a = And(state, state->a, opcode[1]);
 			state->pc++;
 			break;
 		}
-		case 0xe7: NotImplementedInstruction(state); break;
-		case 0xe8: NotImplementedInstruction(state); break;
-		case 0xe9: NotImplementedInstruction(state); break;
-		case 0xea: NotImplementedInstruction(state); break;
-		case 0xeb: {
-            uint8_t save1 = state->d;
-            uint8_t save2 = state->e;
-            state->d = state->h;
-            state->e = state->l;
-            state->h = save1;
-            state->l = save2;
+		case 0xe7: Restart(state, 0x20); break; // RST 4
+		case 0xe8: ConditionalReturn(state, ParityEven(state)); break; // RPE
+		case 0xe9: state->pc = state->hl; break; //PCHL
+		case 0xea: ConditionalJump(state, opcode, ParityEven(state)); break; // JPE
+		case 0xeb: { //XCHG
+			uint16_t de = state->de;
+			state->de = state->hl;
+			state->hl = de;
 			break;
-        }
-		case 0xec: NotImplementedInstruction(state); break;
-		case 0xed: NotImplementedInstruction(state); break;
-		case 0xee: NotImplementedInstruction(state); break;
-		case 0xef: NotImplementedInstruction(state); break;
-		case 0xf0: NotImplementedInstruction(state); break;
+		}
+		case 0xec: ConditionalCall(state, opcode, ParityEven(state)); break; // CPE
+		case 0xed: { // CALL address (undocumented)
+			uint16_t target = (opcode[2] << 8) | opcode[1];
+			uint16_t ret = state->pc+2;
+			WriteMemory(state, state->sp-1, (ret >> 8) & 0xff);
+			WriteMemory(state, state->sp-2, (ret & 0xff));
+			state->sp = state->sp - 2;
+			state->pc = target;
+			break;
+		}
+		case 0xee: state->a = Xor(state, state->a, opcode[1]); state->pc++; break; //XRI byte
+		case 0xef: Restart(state, 0x28); break; // RST 5
+		case 0xf0: ConditionalReturn(state, !Sign(state)); break; // RP
 		case 0xf1: {
-            state->a = state->memory[state->sp+1];
-            uint8_t psw = state->memory[state->sp];
-            state->flags.z  = (0x01 == (psw & 0x01));
-            state->flags.s  = (0x02 == (psw & 0x02));
-            state->flags.p  = (0x04 == (psw & 0x04));
-            state->flags.cy = (0x05 == (psw & 0x08));
-            state->flags.ac = (0x10 == (psw & 0x10));
+            state->a = ReadMemory(state, state->sp+1);
+            SetFlags(state, ReadMemory(state, state->sp));
             state->sp += 2;
 			break;
         }
-		case 0xf2: NotImplementedInstruction(state); break;
-		case 0xf3: NotImplementedInstruction(state); break;
-		case 0xf4: NotImplementedInstruction(state); break;
+		case 0xf2: ConditionalJump(state, opcode, !Sign(state)); break; // JP
+		case 0xf3: state->int_enable = 0; break; //DI
+		case 0xf4: ConditionalCall(state, opcode, !Sign(state)); break; // CP
 		case 0xf5: {
-			state->memory[state->sp-1] = state->a;
-			uint8_t psw = (state->flags.z |
-						state->flags.s << 1 |
-						state->flags.p << 2 |
-						state->flags.cy << 3 |
-						state->flags.ac << 4 );
-			state->memory[state->sp-2] = psw;
+			WriteMemory(state, state->sp-1, state->a);
+			WriteMemory(state, state->sp-2, Flags(state));
 			state->sp = state->sp - 2;
 			break;
         }
-		case 0xf6: NotImplementedInstruction(state); break;
-		case 0xf7: NotImplementedInstruction(state); break;
-		case 0xf8: NotImplementedInstruction(state); break;
-		case 0xf9: NotImplementedInstruction(state); break;
-		case 0xfa: NotImplementedInstruction(state); break;
+		case 0xf6: state->a = Or(state, state->a, opcode[1]); state->pc++; break; //ORI byte
+		case 0xf7: Restart(state, 0x30); break; // RST 6
+		case 0xf8: ConditionalReturn(state, Sign(state)); break; // RM
+		case 0xf9: state->sp = state->hl; break; //SPHL
+		case 0xfa: ConditionalJump(state, opcode, Sign(state)); break; // JM
 		case 0xfb: {
            state->int_enable = 1;
            break;
         }
-		case 0xfc: NotImplementedInstruction(state); break;
-		case 0xfd: NotImplementedInstruction(state); break;
+		case 0xfc: ConditionalCall(state, opcode, Sign(state)); break; // CM
+		case 0xfd: { // CALL address (undocumented)
+			uint16_t target = (opcode[2] << 8) | opcode[1];
+			uint16_t ret = state->pc+2;
+			WriteMemory(state, state->sp-1, (ret >> 8) & 0xff);
+			WriteMemory(state, state->sp-2, (ret & 0xff));
+			state->sp = state->sp - 2;
+			state->pc = target;
+			break;
+		}
 		case 0xfe: {
-			uint8_t x = state->a - opcode[1];
-			state->flags.z = (x == 0);
-			state->flags.s = (0x80 == (x & 0x80));
-			state->flags.p = Parity(x, 8);
-			state->flags.cy = (state->a < opcode[1]);
+			Subtract(state, state->a, opcode[1], 0); //CPI byte
 			state->pc++;
 			break;
         }
-		case 0xff: NotImplementedInstruction(state); break;
+		case 0xff: Restart(state, 0x38); break; // RST 7
 	}
-	DumpProcessorState(state);
+}
+
+int Emulator8080::Emulate8080Operation(State8080* state){
+    uint8_t fetched[3];
+    const unsigned char *opcode = Fetch(state->pc, fetched);
+#ifdef EMULATOR8080_TRACE
+	if (traceWriter) BinaryTrace::BeforeInstruction(this, state);
+#endif
+#ifdef EMULATOR8080_PROFILE
+	if (profiler) ProfileTrace::BeforeInstruction(this, state);
+#endif
+	state->pc+=1;
+	state->cycles += OPCODE_CYCLES[*opcode];
+	state->instructions++;
+	ExecuteInstruction(state, *opcode, opcode);
+#ifdef EMULATOR8080_PROFILE
+	if (profiler) ProfileTrace::AfterInstruction(this, state);
+#endif
 	return 0;
 }
 
+template<uint8_t Op>
+void Emulator8080::ExecuteOpcode(Emulator8080* emulator, State8080* state, const unsigned char *opcode) {
+    state->pc += 1;
+    emulator->ExecuteInstruction(state, Op, opcode);
+}
+
+template<size_t... Ops>
+constexpr std::array<Emulator8080::OpcodeHandler, 256> Emulator8080::MakeOpcodeHandlers(std::index_sequence<Ops...>) {
+    return {{ &Emulator8080::ExecuteOpcode<Ops>... }};
+}
+
+const std::array<Emulator8080::OpcodeHandler, 256> Emulator8080::opcodeHandlers = MakeOpcodeHandlers(std::make_index_sequence<256>());
+
+uint32_t Emulator8080::Run(uint32_t instructions) {
+    uint64_t start = processor.instructions;
+    uint64_t target = start + instructions;
+    Execute([target](const State8080* cpu) { return cpu->instructions >= target; });
+    return processor.instructions - start;
+}
+
+uint64_t Emulator8080::RunFor(uint64_t cycles) {
+    uint64_t start = processor.cycles;
+    uint64_t target = start + cycles;
+    while (processor.cycles < target) {
+        // Run uninterrupted up to the next event, then dispatch whatever is due
+        uint64_t until = std::min(target, events.NextDeadline());
+        if (!processor.halted)
+            Execute([until](const State8080* cpu) { return cpu->cycles >= until; });
+        else if (processor.int_enable)
+            processor.cycles = std::max(processor.cycles, until); // HLT idles until an interrupt
+        else
+            break;
+        events.Dispatch(processor.cycles);
+    }
+    return processor.cycles - start;
+}
+
+Emulator8080::Backend Emulator8080::SetBackend(Backend selected) {
+    if (selected == BACKEND_JIT && !JitAvailable()) {
+        printf("warning: no JIT for this host, using the block cache\n");
+        selected = BACKEND_BLOCK_CACHE;
+    }
+    if (selected != BACKEND_THREADED && blocks.empty()) blocks.resize(0x10000);
+    backend = selected;
+    return backend;
+}
+
+Emulator8080::Block* Emulator8080::CompileBlock(uint16_t pc) {
+    Block *block = new Block();
+    block->start = pc;
+    bool cacheable = true;
+    uint16_t address = pc;
+    for (int i = 0; i < MAX_BLOCK_INSTRUCTIONS; i++) {
+        uint8_t op = ReadMemory(&processor, address);
+        MicroOp micro;
+        micro.handler = opcodeHandlers[op];
+        micro.length = OPCODE_LENGTHS[op];
+        micro.cycles = OPCODE_CYCLES[op];
+        micro.bytes[0] = op;
+        for (int b = 1; b < 3; b++) micro.bytes[b] = b < micro.length ? ReadMemory(&processor, address + b) : 0;
+        block->ops.push_back(micro);
+
+        for (int b = 0; b < micro.length; b++) {
+            uint8_t page = (uint16_t)(address + b) >> 8;
+            if (readPages[page] == nullptr) {
+                cacheable = false;
+                continue;
+            }
+            page = MemoryPage(page);
+            if (pageBlocks[page].empty() || pageBlocks[page].back() != pc) pageBlocks[page].push_back(pc);
+            if ((JIT_THRESHOLD << codeRewrites[page]) > block->jitThreshold) block->jitThreshold = JIT_THRESHOLD << codeRewrites[page];
+            if (!codePages[page]) ProtectMemoryPage(page);
+            codePages[page] = 1;
+        }
+        address += micro.length;
+        if (EndsBasicBlock(op)) break;
+    }
+    for (size_t i = 0; i + 1 < block->ops.size(); i++) block->leadCycles += block->ops[i].cycles;
+    if (!cacheable) {
+        // Decoded from a handler, which can change what it reads at any
+        // time: used for this one run only
+        uncachedBlock.reset(block);
+        return block;
+    }
+    blocks[pc].reset(block);
+    return block;
+}
+
+void Emulator8080::InvalidateStaleBlocks() {
+    for (uint8_t page : staleCodePages) {
+        for (uint16_t start : pageBlocks[page]) blocks[start].reset();
+        pageBlocks[page].clear();
+        if (codeRewrites[page] < JIT_BACKOFF_LIMIT) codeRewrites[page]++;
+    }
+    staleCodePages.clear();
+}
+
+void Emulator8080::RestoreMachine(const MachineState& machine) {
+    const Registers& r = machine.registers;
+    processor.a = r.a; processor.b = r.b; processor.c = r.c;
+    processor.d = r.d; processor.e = r.e; processor.h = r.h; processor.l = r.l;
+    SetFlags(&processor, r.flags);
+    processor.sp = r.sp;
+    processor.pc = r.pc;
+    processor.int_enable = r.int_enable;
+    processor.halted = r.halted;
+    processor.cycles = r.cycles;
+    processor.instructions = r.instructions;
+    io.Get<ShiftRegister>().Restore(machine.shiftValue, machine.shiftOffset);
+    events.Realign(processor.cycles);
+}
+
+void Emulator8080::RestorePage(uint8_t page, const uint8_t* data) {
+    uint16_t base = page * PAGE_SIZE;
+    memcpy(processor.memory + base, data, PAGE_SIZE);
+    writtenPages[page >> 6] |= 1ull << (page & 63);
+    modifiedPages[page >> 6] |= 1ull << (page & 63);
+    if (codePages[page]) {
+        codePages[page] = 0;
+        staleCodePages.push_back(page);
+    }
+}
+
+void Emulator8080::Reset() {
+    // A page only gets a fast write pointer from a store on the slow path,
+    // which marks it modified, so the bitmap covers every store
+    const uint8_t *pristine = romSet->Pristine();
+    for (int page = 0; page < PAGES; page++) {
+        uint64_t bit = 1ull << (page & 63);
+        if (!(modifiedPages[page >> 6] & bit)) continue;
+        memcpy(processor.memory + page * PAGE_SIZE, pristine + page * PAGE_SIZE, PAGE_SIZE);
+        writtenPages[page >> 6] |= bit;
+    }
+    for (uint64_t& word : modifiedPages) word = 0;
+    for (int page = 0; page < PAGES; page++) writePages[page] = nullptr;
+
+    uint8_t *memory = processor.memory;
+    processor = State8080();
+    processor.memory = memory;
+    processor.flags = FLAG_ALWAYS_ONE;
+    io = MakeInvadersIo();
+    events.Clear();
+
+    for (std::vector<uint16_t>& starts : pageBlocks) {
+        for (uint16_t start : starts) blocks[start].reset();
+        starts.clear();
+    }
+    memset(codePages, 0, sizeof(codePages));
+    memset(codeRewrites, 0, sizeof(codeRewrites));
+    staleCodePages.clear();
+    uncachedBlock.reset();
+    jitCodeUsed = 0;
+    jitMismatches = 0;
+    videoDirty.MarkAll();
+}
+
+uint8_t Emulator8080::ReadMemorySlow(uint16_t address) {
+    const MemoryHandler *handler = pageHandlers[address >> 8];
+    return handler->read ? handler->read(address) : 0xff;
+}
+
+void Emulator8080::WriteMemorySlow(uint16_t address, uint8_t value) {
+    if (writeLog) writeLog->push_back({address, value});
+    uint8_t page = address >> 8;
+    if (pageHandlers[page] != nullptr) {
+        if (pageHandlers[page]->write) pageHandlers[page]->write(address, value);
+        return;
+    }
+    uint8_t memoryPage = MemoryPage(page);
+    uint16_t target = (memoryPage << 8) | (address & 0xff);
+    PageAccess access = pageAccess[memoryPage];
+    if (access == PAGE_ROM || (access == PAGE_PARTLY_ROM && romSet->IsReadOnly(target))) return;
+
+    processor.memory[target] = value;
+    writtenPages[memoryPage >> 6] |= 1ull << (memoryPage & 63);
+    modifiedPages[memoryPage >> 6] |= 1ull << (memoryPage & 63);
+    if (codePages[memoryPage]) {
+        // The block being executed may be the one invalidated, so only
+        // mark the page here and let the block loop stop
+        codePages[memoryPage] = 0;
+        staleCodePages.push_back(memoryPage);
+    }
+    if (access == PAGE_RAM && writeLog == nullptr) writePages[page] = processor.memory + (memoryPage << 8);
+}
+
+VideoDirtyMap Emulator8080::TakeVideoDirty() {
+    VideoDirtyMap dirty = videoDirty;
+    videoDirty.Clear();
+    const uint8_t *video = processor.memory + VideoDirtyMap::START;
+    for (int line = 0; line < VideoDirtyMap::LINES; line++) {
+        int offset = line * VideoDirtyMap::LINE_BYTES;
+        if (memcmp(video + offset, videoShadow + offset, VideoDirtyMap::LINE_BYTES) == 0) continue;
+        memcpy(videoShadow + offset, video + offset, VideoDirtyMap::LINE_BYTES);
+        dirty.Mark(VideoDirtyMap::START + offset);
+    }
+    return dirty;
+}
+
+void Emulator8080::ProtectMemoryPage(uint8_t page) {
+    const uint8_t *memory = processor.memory + page * PAGE_SIZE;
+    for (int mapped = 0; mapped < PAGES; mapped++) {
+        if (readPages[mapped] == memory) writePages[mapped] = nullptr;
+    }
+}
+
+void Emulator8080::DropCachedCode() {
+    for (int page = 0; page < PAGES; page++) {
+        if (!codePages[page]) continue;
+        codePages[page] = 0;
+        staleCodePages.push_back(page);
+    }
+}
+
+void Emulator8080::MapMirror(uint16_t address, uint32_t size, uint16_t source, uint32_t sourceSize) {
+    for (uint32_t offset = 0; offset < size; offset += PAGE_SIZE) {
+        uint8_t page = (address + offset) >> 8;
+        readPages[page] = processor.memory + source + offset % sourceSize;
+        writePages[page] = nullptr;
+        pageHandlers[page] = nullptr;
+    }
+    // Cached code may have been decoded through the old mapping
+    DropCachedCode();
+}
+
+void Emulator8080::MapHandler(uint16_t address, uint32_t size, ReadHandler read, WriteHandler write) {
+    memoryHandlers.emplace_back(new MemoryHandler{std::move(read), std::move(write)});
+    for (uint32_t offset = 0; offset < size; offset += PAGE_SIZE) {
+        uint8_t page = (address + offset) >> 8;
+        readPages[page] = nullptr;
+        writePages[page] = nullptr;
+        pageHandlers[page] = memoryHandlers.back().get();
+    }
+    DropCachedCode();
+}
+
+bool Emulator8080::SetTraceWriter(TraceWriter* writer) {
+#ifdef EMULATOR8080_TRACE
+    traceWriter = writer;
+#else
+    if (writer) printf("warning: tracing requested but this build has no trace support (rebuild with 'make trace')\n");
+#endif
+    return traceWriter != nullptr;
+}
+
+bool Emulator8080::SetProfiler(Profiler* selected) {
+#ifdef EMULATOR8080_PROFILE
+    profiler = selected;
+#else
+    if (selected) printf("warning: profiling requested but this build has no profiler (rebuild with 'make profile')\n");
+#endif
+    return profiler != nullptr;
+}
@@ -1,107 +1,740 @@
 #ifndef _EMULATOR8080_H_
 #define _EMULATOR8080_H_
 #include <iostream>
+#include <array>
+#include <functional>
+#include <memory>
+#include <string.h>
+#include <utility>
+#include <vector>
+#include "invadersio.h"
+#include "opcodes8080.h"
+#include "profiler.h"
+#include "romset.h"
+#include "scheduler.h"
+#include "tracewriter.h"
+#include "videoram.h"
+
+// Flag bits in the layout PUSH PSW stores them: S Z 0 AC 0 P 1 CY
+enum : uint8_t {
+    FLAG_CY = 0x01, // (carry) set to 1 when the instruction resulted in a carry out or borrow into the high order bit
+    FLAG_P  = 0x04, // (parity) is set when the answer has even parity, clear when odd parity. PS: Trivia, have a look at (SEU) single event upsets.
+    FLAG_AC = 0x10, // (auxillary carry) is used mostly for BCD (binary coded decimal) math.
+    FLAG_Z  = 0x40, // (zero) set to 1 when the result is 0
+    FLAG_S  = 0x80, // (sign) set to 1 when bit 7 (the most significant bit or MSB) of the math instruction is set
+    FLAG_ALWAYS_ONE = 0x02,
+    FLAGS_ZSP = FLAG_S | FLAG_Z | FLAG_P
+};
+
+// Sign, zero and parity flags for every possible 8 bit result, built at compile time
+struct ZspTable {
+    uint8_t value[256];
+    constexpr ZspTable() : value() {
+        for (int i = 0; i < 256; i++) {
+            int bits = 0;
+            for (int x = i; x != 0; x >>= 1) bits += x & 1;
+            value[i] = (i == 0 ? FLAG_Z : 0) | (i & 0x80 ? FLAG_S : 0) | ((bits & 1) == 0 ? FLAG_P : 0);
+        }
+    }
+};
+constexpr ZspTable ZSP_TABLE{};
+
+template<int Lanes> class LaneGroup;
+class BlockTranslator;
 
 class Emulator8080 {
+    // Runs the registers of several instances side by side (lanes8080.cpp)
+    template<int Lanes> friend class LaneGroup;
+    // Emits native code for a block (jit8080.cpp)
+    friend class BlockTranslator;
+
+    public:
+        // Execution engines behind Run, RunFor and RunUntil. Every backend
+        // shares the instruction bodies in ExecuteInstruction.
+        enum Backend {
+            BACKEND_THREADED,       // handler table indexed by the opcode byte
+            BACKEND_BLOCK_CACHE,    // pre-decoded basic blocks keyed by pc
+            BACKEND_JIT             // block cache plus x86-64 code for hot blocks
+        };
+
+        // Copy of the architectural state, with the flags fully evaluated
+        struct Registers {
+            uint8_t     a, b, c, d, e, h, l;
+            uint8_t     flags;
+            uint16_t    sp, pc;
+            uint8_t     int_enable;
+            uint8_t     halted;
+            uint64_t    cycles;
+            uint64_t    instructions;
+        };
+
+        struct MemoryWrite {
+            uint16_t    address;
+            uint8_t     value;
+        };
+
+        // Everything but memory and host input that a save-state restores
+        struct MachineState {
+            Registers   registers;
+            uint16_t    shiftValue;
+            uint8_t     shiftOffset;
+        };
+
+        static const int PAGE_SIZE = 0x100;
+        static const int PAGES = 0x100;
+
+        // Callbacks for pages mapped to a device instead of memory
+        typedef std::function<uint8_t(uint16_t address)> ReadHandler;
+        typedef std::function<void(uint16_t address, uint8_t value)> WriteHandler;
+
     private:
         //Emulator (Processor State, etc)
-        typedef struct Flags {
-            uint8_t     z:1; // (zero) set to 1 when the result is 0
-            uint8_t     s:1; // (sign) set to 1 when bit 7 (the most significant bit or MSB) of the math instruction is set
-            uint8_t     p:1; // (parity) is set when the answer has even parity, clear when odd parity. PS: Trivia, have a look at (SEU) single event upsets.
-            uint8_t     cy:1; // (carry) set to 1 when the instruction resulted in a carry out or borrow into the high order bit
-            uint8_t     ac:1; // auxillary carry) is used mostly for BCD (binary coded decimal) math.
-            uint8_t     pad:3;
-        } Flags;
-
-        typedef struct State8080 {
-            // 7 x 8 bit registers
-            uint8_t     a;
-            uint8_t     b;
-            uint8_t     c;
-            uint8_t     d;
-            uint8_t     e;
-            uint8_t     h;
-            uint8_t     l;
+
+        // Register pairs overlay their two 8 bit registers, so the 16 bit
+        // instructions (LXI, INX, DCX, DAD, XCHG, PCHL, SPHL) work on the pair
+        // directly. The first register named is the high byte, which puts it
+        // second in memory on a little endian host. psw is only current once
+        // Flags() has folded the lazy S, Z and P bits into flags.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define EMULATOR8080_PAIR(high, low, pair) union { struct { uint8_t high, low; }; uint16_t pair; }
+#else
+#define EMULATOR8080_PAIR(high, low, pair) union { struct { uint8_t low, high; }; uint16_t pair; }
+#endif
+        // Everything an instruction touches sits in the first cache line;
+        // the state lives inline in the emulator, so no pointer is followed
+        // to reach it
+        struct alignas(64) State8080 {
+            EMULATOR8080_PAIR(b, c, bc);
+            EMULATOR8080_PAIR(d, e, de);
+            EMULATOR8080_PAIR(h, l, hl);
+            // Packed flags in PSW layout. Carry and auxiliary carry are always
+            // current; sign, zero and parity are evaluated lazily from the
+            // last result (zsp) while flags_lazy is set.
+            EMULATOR8080_PAIR(a, flags, psw);
 
             //the stack pointer and program counter are 16 bits each
             uint16_t    sp; //stack pointer
             uint16_t    pc; //program counter
 
-            uint8_t     *memory;
-            struct      Flags flags;
+            uint8_t     zsp;
+            uint8_t     flags_lazy;
             uint8_t     int_enable;
-        } State8080;
+            uint8_t     halted; //set when execution cannot continue
 
-        State8080* state;
+            uint64_t    cycles; //machine cycles executed since reset
+            uint64_t    instructions; //instructions executed since reset
+            uint8_t     *memory;
+        };
+#undef EMULATOR8080_PAIR
+        static_assert(sizeof(State8080) == 64, "the processor state is one cache line");
 
-        void LoadFileIntoMemoryAt(State8080* state, char* filename, uint32_t offset) {
-            FILE *romFile = fopen(filename, "rb");
-            if (romFile == NULL){
-                printf("error: Couldn't open %s\n", filename);
-                exit(1);
+        // Emulator8080 is over-aligned for it: allocate instances on the
+        // stack, as members, or with an aligned allocation (C++17 new)
+        State8080 processor = {};
+
+        void ConditionalJump(State8080* state, const unsigned char *opcode, bool condition) {
+            if (condition)
+                state->pc = (opcode[2] << 8) | opcode[1];
+            else
+                state->pc += 2;
+        }
+
+        void ConditionalReturn(State8080* state, bool condition) {
+            if (condition) {
+                state->pc = ReadMemory(state, state->sp) | (ReadMemory(state, state->sp+1) << 8);
+                state->sp += 2;
+                state->cycles += 6;
+            }
+        }
+
+        void ConditionalCall(State8080* state, const unsigned char *opcode, bool condition) {
+            if (condition) {
+                uint16_t target = (opcode[2] << 8) | opcode[1];
+                uint16_t ret = state->pc+2;
+                WriteMemory(state, state->sp-1, (ret >> 8) & 0xff);
+                WriteMemory(state, state->sp-2, (ret & 0xff));
+                state->sp = state->sp - 2;
+                state->pc = target;
+                state->cycles += 6;
+            } else {
+                state->pc += 2;
             }
-            fseek(romFile, 0L, SEEK_END);
-            int fsize = ftell(romFile);
-            fseek(romFile, 0L, SEEK_SET);
+        }
 
-            unsigned char *buffer = &state->memory[offset];
-            fread(buffer, fsize, 1, romFile);
-            fclose(romFile); 
+        // RST n: a one byte call to vector n * 8
+        void Restart(State8080* state, uint16_t vector) {
+            WriteMemory(state, state->sp-1, (state->pc >> 8) & 0xff);
+            WriteMemory(state, state->sp-2, (state->pc & 0xff));
+            state->sp = state->sp - 2;
+            state->pc = vector;
         }
 
-        int Parity(int x, int size)
-        {
-            int i;
-            int p = 0;
-            x = (x & ((1<<size)-1));
-            for (i=0; i<size; i++)
-            {
-                if (x & 0x1) p++;
-                x = x >> 1;
+        // Flag access. ALU results only record the byte S/Z/P derive from;
+        // Flags() materializes the full PSW byte when PUSH PSW or DAA needs it
+        // and the conditional branches test the recorded result directly.
+        void SetResultFlags(State8080* state, uint8_t result) {
+            state->zsp = result;
+            state->flags_lazy = 1;
+        }
+        uint8_t Flags(State8080* state) {
+            if (state->flags_lazy) {
+                state->flags = (state->flags & ~FLAGS_ZSP) | ZSP_TABLE.value[state->zsp];
+                state->flags_lazy = 0;
             }
-            return (0 == (p & 0x1));
+            return state->flags;
         }
-        void InitializeProcessorState() {
-            state = new State8080();
-            state->memory = (uint8_t *)malloc(0x10000);
+        void SetFlags(State8080* state, uint8_t psw) {
+            state->flags = (psw & (FLAGS_ZSP | FLAG_AC | FLAG_CY)) | FLAG_ALWAYS_ONE;
+            state->flags_lazy = 0;
         }
+        void SetCarry(State8080* state, bool carry) {
+            state->flags = (state->flags & ~FLAG_CY) | (carry ? FLAG_CY : 0);
+        }
+        bool Zero(State8080* state) { return state->flags_lazy ? state->zsp == 0 : (state->flags & FLAG_Z) != 0; }
+        bool Sign(State8080* state) { return state->flags_lazy ? (state->zsp & 0x80) != 0 : (state->flags & FLAG_S) != 0; }
+        bool ParityEven(State8080* state) { return (Flags(state) & FLAG_P) != 0; }
+        bool Carry(State8080* state) { return (state->flags & FLAG_CY) != 0; }
 
-        void NotImplementedInstruction(State8080* state){
-            printf("Error: Not Implemented Instruction\n");
-            exit(1);
+        // ALU helpers shared by the register, memory and immediate forms
+        uint8_t Add(State8080* state, uint8_t a, uint8_t value, uint8_t carry) {
+            uint16_t answer = a + value + carry;
+            uint8_t ac = ((a & 0xf) + (value & 0xf) + carry) > 0xf ? FLAG_AC : 0;
+            state->flags = (state->flags & ~(FLAG_CY | FLAG_AC)) | (answer > 0xff ? FLAG_CY : 0) | ac;
+            SetResultFlags(state, answer & 0xff);
+            return answer & 0xff;
+        }
+        uint8_t Subtract(State8080* state, uint8_t a, uint8_t value, uint8_t borrow) {
+            // The 8080 subtracts by adding the complement, so the auxiliary
+            // carry is the carry out of that nibble addition
+            uint16_t answer = a - value - borrow;
+            uint8_t ac = ((a & 0xf) + (~value & 0xf) + !borrow) > 0xf ? FLAG_AC : 0;
+            state->flags = (state->flags & ~(FLAG_CY | FLAG_AC)) | ((answer >> 8) & FLAG_CY) | ac;
+            SetResultFlags(state, answer & 0xff);
+            return answer & 0xff;
+        }
+        uint8_t And(State8080* state, uint8_t a, uint8_t value) {
+            uint8_t ac = ((a | value) & 0x08) ? FLAG_AC : 0;
+            state->flags = (state->flags & ~(FLAG_CY | FLAG_AC)) | ac;
+            SetResultFlags(state, a & value);
+            return a & value;
+        }
+        uint8_t Or(State8080* state, uint8_t a, uint8_t value) {
+            state->flags &= ~(FLAG_CY | FLAG_AC);
+            SetResultFlags(state, a | value);
+            return a | value;
+        }
+        uint8_t Xor(State8080* state, uint8_t a, uint8_t value) {
+            state->flags &= ~(FLAG_CY | FLAG_AC);
+            SetResultFlags(state, a ^ value);
+            return a ^ value;
+        }
+        uint8_t Increment(State8080* state, uint8_t value) {
+            uint8_t res = value + 1;
+            state->flags = (state->flags & ~FLAG_AC) | ((res & 0xf) == 0 ? FLAG_AC : 0);
+            SetResultFlags(state, res);
+            return res;
+        }
+        uint8_t Decrement(State8080* state, uint8_t value) {
+            uint8_t res = value - 1;
+            state->flags = (state->flags & ~FLAG_AC) | ((res & 0xf) != 0xf ? FLAG_AC : 0);
+            SetResultFlags(state, res);
+            return res;
+        }
+        void DecimalAdjust(State8080* state) {
+            uint8_t flags = Flags(state);
+            uint8_t correction = 0;
+            bool carry = (flags & FLAG_CY) != 0;
+            uint8_t lsb = state->a & 0x0f;
+            uint8_t msb = state->a >> 4;
+            if ((flags & FLAG_AC) || lsb > 9)
+                correction |= 0x06;
+            if (carry || msb > 9 || (msb >= 9 && lsb > 9)) {
+                correction |= 0x60;
+                carry = true;
+            }
+            state->a = Add(state, state->a, correction, 0);
+            SetCarry(state, carry);
         }
 
-        void DumpProcessorState(State8080* state) {
-            printf("------------------------\n");
-            printf("Flags:\n");
-            printf("\tC (carry)=%d,P (parity)=%d,S (sign)=%d,Z (zero)=%d\n", state->flags.cy, state->flags.p,    
-               state->flags.s, state->flags.z);    
-            printf("Registers:\n");
-            printf("\t\tAF \t\tBC \t\tDE \t\tHL \t\tPC (program counter) \tSP (stack pointer)\n");
-            printf("\t\t%02x \t\t%02x%02x \t\t%02x%02x \t\t%02x%02x \t\t%02x \t\t\t%02x\n",
-                   state->a,
-                   state->b, state->c,
-                   state->d, state->e,
-                   state->h, state->l,
-                   state->pc, state->sp
-            );
+        // Takes memory mapped from the ROM set when memory is null, or
+        // caller-owned memory that is filled from the pristine image
+        void InitializeProcessorState(const RomSet& roms, uint8_t* memory) {
+            romSet = &roms;
+            int readOnly[PAGES] = {};
+            for (const RomSet::Image& image : roms.Images()) {
+                if (!image.readOnly) continue;
+                for (uint32_t address = image.address; address < image.address + image.size; address++) readOnly[address >> 8]++;
+            }
+            for (int page = 0; page < PAGES; page++)
+                pageAccess[page] = readOnly[page] == 0 ? PAGE_RAM : readOnly[page] == PAGE_SIZE ? PAGE_ROM : PAGE_PARTLY_ROM;
+            processor.flags = FLAG_ALWAYS_ONE;
+            ownsMemory = memory == nullptr;
+            processor.memory = ownsMemory ? roms.MapMemory() : memory;
+            if (processor.memory == nullptr) {
+                printf("error: Couldn't map emulator memory\n");
+                exit(1);
+            }
+            if (!ownsMemory) memcpy(processor.memory, roms.Pristine(), RomSet::MEMORY_SIZE);
+            MapMirror(0, RomSet::MEMORY_SIZE, 0, RomSet::MEMORY_SIZE);
+            for (const RomSet::Mirror& mirror : roms.Mirrors()) MapMirror(mirror.address, mirror.size, mirror.source, mirror.sourceSize);
+            videoDirty.MarkAll();
         }
 
-        int Disassemble8080Opcodes(unsigned char *codebuffer, int pc);
+        // Trace policies for the execution loop. NoTrace compiles every hook
+        // away; BinaryTrace appends the CPU state before each instruction to
+        // the trace writer. BinaryTrace is only instantiated in trace builds
+        // (-DEMULATOR8080_TRACE).
+        struct NoTrace {
+            static void BeforeInstruction(Emulator8080* emulator, State8080* state) {}
+            static void AfterInstruction(Emulator8080* emulator, State8080* state) {}
+        };
+        struct BinaryTrace {
+            static void BeforeInstruction(Emulator8080* emulator, State8080* state) {
+                TraceRecord& record = emulator->traceWriter->Append();
+                record.cycles = state->cycles;
+                record.pc = state->pc;
+                record.sp = state->sp;
+                for (int i = 0; i < 3; i++) record.opcode[i] = emulator->Peek(state->pc + i);
+                record.a = state->a; record.b = state->b; record.c = state->c;
+                record.d = state->d; record.e = state->e; record.h = state->h; record.l = state->l;
+                record.flags = emulator->Flags(state);
+                record.status = (state->int_enable ? TRACE_INTERRUPTS_ENABLED : 0) | (state->halted ? TRACE_HALTED : 0);
+            }
+            static void AfterInstruction(Emulator8080* emulator, State8080* state) {}
+        };
+
+        // Feeds the profiler; only instantiated in profile builds
+        // (-DEMULATOR8080_PROFILE)
+        struct ProfileTrace {
+            static void BeforeInstruction(Emulator8080* emulator, State8080* state) {
+                emulator->profiler->BeforeInstruction(state->pc, state->sp, emulator->Peek(state->pc), state->cycles);
+            }
+            static void AfterInstruction(Emulator8080* emulator, State8080* state) {
+                emulator->profiler->AfterInstruction(state->pc, state->sp, state->cycles);
+            }
+        };
+
+        TraceWriter *traceWriter = nullptr;
+        Profiler *profiler = nullptr;
+        // The machine's I/O is a concrete type so IN and OUT inline into
+        // every backend's instruction bodies
+        InvadersIo io = MakeInvadersIo();
+
+        // Threaded dispatch: one handler per opcode, indexed by the opcode byte.
+        // Handlers take the instruction bytes separately from the pc so that
+        // pre-decoded copies can be executed as well as memory in place. They
+        // do not count cycles; the dispatch loops add OPCODE_CYCLES.
+        typedef void (*OpcodeHandler)(Emulator8080* emulator, State8080* state, const unsigned char *opcode);
+        template<uint8_t Op> static void ExecuteOpcode(Emulator8080* emulator, State8080* state, const unsigned char *opcode);
+        template<size_t... Ops> static constexpr std::array<OpcodeHandler, 256> MakeOpcodeHandlers(std::index_sequence<Ops...>);
+        static const std::array<OpcodeHandler, 256> opcodeHandlers;
+
+        void ExecuteInstruction(State8080* state, uint8_t op, const unsigned char *opcode);
+        // Reference path: decodes one instruction through the switch
         int Emulate8080Operation(State8080* state);
 
+        // Threaded dispatch loop: one indexed indirect call per instruction
+        // until done(state) returns true
+        template<typename Trace, typename Predicate>
+        void RunLoop(Predicate done) {
+            const OpcodeHandler *handlers = opcodeHandlers.data();
+            State8080 *cpu = &processor;
+            uint8_t fetched[3];
+            while (!cpu->halted && !done(cpu)) {
+                Trace::BeforeInstruction(this, cpu);
+                const uint8_t *opcode = Fetch(cpu->pc, fetched);
+                cpu->cycles += OPCODE_CYCLES[*opcode];
+                cpu->instructions++;
+                handlers[*opcode](this, cpu, opcode);
+                Trace::AfterInstruction(this, cpu);
+            }
+        }
+
+        // Pre-decoded block cache. A block is a straight-line run of
+        // instructions ending at the first jump, call, return, RST, PCHL or
+        // HLT, decoded once into micro-ops that carry their handler, operand
+        // bytes and base cycle cost. Blocks are keyed by their start address
+        // and dropped when any page they were decoded from is written (the
+        // page of memory behind the address, so a store through a mirror
+        // drops code fetched from the original and the other way round).
+        struct MicroOp {
+            OpcodeHandler   handler;
+            uint8_t         bytes[3];   // opcode and resolved operands
+            uint8_t         length;
+            uint8_t         cycles;
+        };
+        // Native code for a block; it updates pc, cycles and the instruction
+        // count itself, and may leave before the end of the block
+        typedef void (*NativeCode)(State8080* state);
+        struct Block {
+            uint16_t        start;
+            std::vector<MicroOp> ops;
+            uint32_t        leadCycles = 0;     // base cycles of every op but the last
+            uint32_t        executions = 0;
+            uint32_t        jitThreshold = JIT_THRESHOLD;   // executions before it is translated
+            NativeCode      native = nullptr;
+            uint16_t        nativeInstructions = 0;
+        };
+        static const int MAX_BLOCK_INSTRUCTIONS = 64;
+        static const uint32_t JIT_THRESHOLD = 16;   // executions before a block is translated
+        static const uint8_t JIT_BACKOFF_LIMIT = 6; // doublings of the threshold for rewritten code
+
+        Backend backend = BACKEND_THREADED;
+        std::vector<std::unique_ptr<Block>> blocks;     // 64K entries, indexed by start pc
+        std::vector<uint16_t> pageBlocks[256];          // block starts decoded from each page
+        uint8_t codePages[256] = {};                    // memory pages holding cached code
+        uint8_t codeRewrites[256] = {};                 // times each page's cached code was dropped, up to JIT_BACKOFF_LIMIT
+        std::vector<uint8_t> staleCodePages;            // written while cached, dropped between blocks
+        std::unique_ptr<Block> uncachedBlock;           // last block decoded from a handler page
+
+        Block* CompileBlock(uint16_t pc);
+        void InvalidateStaleBlocks();
+
+        // x86-64 translation (jit8080.cpp). Code is bump-allocated from one
+        // executable region that is flushed with the block cache when full;
+        // the pages at the allocation point turn writable only while a
+        // block is emitted into them.
+        uint8_t *jitCode = nullptr;
+        size_t jitCodeUsed = 0;
+        bool jitVerify = false;
+        uint64_t jitMismatches = 0;
+        static const size_t JIT_CODE_SIZE = 1 << 20;
+        static const size_t JIT_BLOCK_CODE_SIZE = 32 << 10;    // room one block is emitted into
+
+        static bool JitAvailable();
+        bool TranslateBlock(Block* block);
+        void RunNativeVerified(Block* block);
+        void ReleaseJitCode();
+
+        std::vector<MemoryWrite> *writeLog = nullptr;
+        EventScheduler events;
+        // Video RAM stores take the plain write path, so TakeVideoDirty finds
+        // the lines that changed by comparing against a copy of the last ones
+        VideoDirtyMap videoDirty;   // lines marked regardless of contents
+        uint8_t videoShadow[VideoDirtyMap::LINES * VideoDirtyMap::LINE_BYTES] = {};
+        uint64_t writtenPages[PAGES / 64] = {};     // pages stored to since the last TakeWrittenPages
+        uint64_t modifiedPages[PAGES / 64] = {};    // pages stored to since Initialize or Reset
+        bool ownsMemory = false;                    // mapped from the ROM set rather than handed in
+
+        const RomSet *romSet = nullptr;
+        std::unique_ptr<RomSet> ownedRomSet;
+
+        // Memory map. Every 256 byte page of the address space has a read
+        // and a write pointer to the page of memory behind it, so an access
+        // is one indexed load from the table and one from the page. Read
+        // pointers are null only for pages mapped to a handler. Write pointers
+        // are also null wherever a store needs more than the store itself:
+        // ROM (stores are dropped), pages holding cached code, pages not yet
+        // marked written since the last TakeWrittenPages, and everything
+        // while a write log is attached.
+        // Those stores take WriteMemorySlow, which does the bookkeeping and
+        // hands the page its pointer back once a plain store will do.
+        enum PageAccess : uint8_t { PAGE_RAM, PAGE_ROM, PAGE_PARTLY_ROM };
+        struct MemoryHandler {
+            ReadHandler     read;
+            WriteHandler    write;
+        };
+        uint8_t *readPages[PAGES] = {};
+        uint8_t *writePages[PAGES] = {};
+        MemoryHandler *pageHandlers[PAGES] = {};
+        std::vector<std::unique_ptr<MemoryHandler>> memoryHandlers;
+        PageAccess pageAccess[PAGES] = {};          // of each page of memory, by the ROM set's images
+
+        uint8_t ReadMemory(State8080* state, uint16_t address) {
+            const uint8_t *page = readPages[address >> 8];
+            return page != nullptr ? page[address & 0xff] : ReadMemorySlow(address);
+        }
+        void WriteMemory(State8080* state, uint16_t address, uint8_t value) {
+            uint8_t *page = writePages[address >> 8];
+            if (page != nullptr) page[address & 0xff] = value;
+            else WriteMemorySlow(address, value);
+        }
+        uint8_t ReadMemorySlow(uint16_t address);
+        void WriteMemorySlow(uint16_t address, uint8_t value);
+        // Memory page behind a page of the address space, which must not be
+        // mapped to a handler
+        uint8_t MemoryPage(uint8_t page) const { return (readPages[page] - processor.memory) >> 8; }
+        // Drops the write pointers of every page of the address space that
+        // shows the given memory page
+        void ProtectMemoryPage(uint8_t page);
+        // Marks every page holding cached code stale, after the map changed
+        void DropCachedCode();
+
+        // The instruction at pc. The bytes are used in place unless they
+        // cross into another page or come from a handler, in which case they
+        // are read into buffer. Handlers read every operand before they
+        // store, so a store over the instruction's own bytes (a CALL pushing
+        // onto its operand) acts the same either way.
+        const uint8_t* Fetch(uint16_t pc, uint8_t* buffer) {
+            const uint8_t *page = readPages[pc >> 8];
+            if (page != nullptr && (pc & 0xff) < PAGE_SIZE - 2) return page + (pc & 0xff);
+            buffer[0] = ReadMemory(&processor, pc);
+            for (int i = 1; i < 3; i++) buffer[i] = i < OPCODE_LENGTHS[buffer[0]] ? ReadMemory(&processor, pc + i) : 0;
+            return buffer;
+        }
+
+        // Interprets a block's micro-ops from first until control leaves the
+        // block or the caller should stop; returns true to stop
+        template<typename Trace, typename Predicate>
+        bool ExecuteBlock(const Block* block, Predicate& done, size_t first = 0) {
+            State8080 *cpu = &processor;
+            for (size_t i = first; i < block->ops.size(); i++) {
+                const MicroOp& op = block->ops[i];
+                uint16_t next = cpu->pc + op.length;
+                Trace::BeforeInstruction(this, cpu);
+                cpu->cycles += op.cycles;
+                cpu->instructions++;
+                op.handler(this, cpu, op.bytes);
+                Trace::AfterInstruction(this, cpu);
+                if (cpu->halted || done(cpu)) return true;
+                if (cpu->pc != next || !staleCodePages.empty()) break;
+            }
+            return false;
+        }
+
+        Block* LookupBlock(uint16_t pc) {
+            if (!staleCodePages.empty()) InvalidateStaleBlocks();
+            Block *block = blocks[pc].get();
+            return block != nullptr ? block : CompileBlock(pc);
+        }
+
+        template<typename Trace, typename Predicate>
+        void RunBlocks(Predicate done) {
+            bool stop = processor.halted || done(&processor);
+            while (!stop) {
+                stop = ExecuteBlock<Trace>(LookupBlock(processor.pc), done);
+            }
+        }
+
+        // True when done holds before the block's last instruction, judged
+        // from the state that far on
+        template<typename Predicate>
+        bool StopsInside(const Block* block, Predicate& done) {
+            State8080 lead = processor;
+            lead.cycles += block->leadCycles;
+            lead.instructions += block->ops.size() - 1;
+            return done(&lead);
+        }
+
+        // Like RunBlocks, but once a block has run JIT_THRESHOLD times it
+        // runs as native code; each time a page's code is rewritten, blocks
+        // decoded from it wait twice as long, as their translation would
+        // likely be thrown away. Native code leaves early at IN, OUT or a
+        // memory access that needs the slow path, and the interpreter
+        // finishes the block from there.
+        //
+        // Native code cannot stop between instructions, so a block runs
+        // natively only when done would not stop it inside. Cycle and
+        // instruction budgets (Run, RunFor) thus end where the interpreter
+        // would end them; a RunUntil predicate that looks past the state
+        // is checked between native runs.
+        template<typename Predicate>
+        void RunJit(Predicate done) {
+            bool stop = processor.halted || done(&processor);
+            while (!stop) {
+                Block *block = LookupBlock(processor.pc);
+                if (block->native == nullptr && ++block->executions == block->jitThreshold) TranslateBlock(block);
+                if (block->native != nullptr && !StopsInside(block, done)) {
+                    uint64_t start = processor.instructions;
+                    if (jitVerify) RunNativeVerified(block);
+                    else block->native(&processor);
+                    stop = processor.halted || done(&processor);
+                    size_t ran = processor.instructions - start;
+                    if (!stop && ran < block->ops.size()) stop = ExecuteBlock<NoTrace>(block, done, ran);
+                } else {
+                    stop = ExecuteBlock<NoTrace>(block, done);
+                }
+            }
+        }
+
+        // Runs the selected backend and trace policy until done(state)
+        template<typename Predicate>
+        void Execute(Predicate done) {
+#ifdef EMULATOR8080_TRACE
+            if (traceWriter) {
+                // Native blocks cannot be traced, so the JIT traces as the block cache
+                if (backend != BACKEND_THREADED) RunBlocks<BinaryTrace>(done);
+                else RunLoop<BinaryTrace>(done);
+                return;
+            }
+#endif
+#ifdef EMULATOR8080_PROFILE
+            if (profiler) {
+                if (backend != BACKEND_THREADED) RunBlocks<ProfileTrace>(done);
+                else RunLoop<ProfileTrace>(done);
+                return;
+            }
+#endif
+            if (backend == BACKEND_JIT) RunJit(done);
+            else if (backend == BACKEND_BLOCK_CACHE) RunBlocks<NoTrace>(done);
+            else RunLoop<NoTrace>(done);
+        }
+
     public:
-        void Initialize() {
-            InitializeProcessorState();
-            LoadFileIntoMemoryAt(state, "invaders.h", 0);
-            LoadFileIntoMemoryAt(state, "invaders.g", 0x800);
-            LoadFileIntoMemoryAt(state, "invaders.f", 0x1000);
-            LoadFileIntoMemoryAt(state, "invaders.e", 0x1800);
+        Emulator8080() {}
+        ~Emulator8080() {
+            ReleaseJitCode();
+            if (ownsMemory) RomSet::UnmapMemory(processor.memory);
+        }
+        Emulator8080(const Emulator8080&) = delete;
+        Emulator8080& operator=(const Emulator8080&) = delete;
+
+        // Maps memory from a ROM set that is already built; any number of
+        // instances can share one set, which must outlive them
+        void Initialize(const RomSet& roms) {
+            InitializeProcessorState(roms, nullptr);
+        }
+        // Runs on 64 KiB of caller-owned memory instead (see EmulatorPool),
+        // which is filled from the set's pristine image and must outlive the
+        // instance
+        void Initialize(const RomSet& roms, uint8_t* memory) {
+            InitializeProcessorState(roms, memory);
         }
+        // Convenience for a single instance that owns its ROM set
+        void Initialize(const char* manifest = "invaders.manifest") {
+            ownedRomSet.reset(new RomSet());
+            if (!ownedRomSet->LoadManifest(manifest)) exit(1);
+            Initialize(*ownedRomSet);
+        }
+        // Back to power-on: the pages stored to since Initialize or the last
+        // Reset are copied back from the pristine image, and the processor,
+        // I/O devices and block cache start over. Scheduled events are
+        // dropped, so the caller schedules them again. The backend, memory
+        // map, write log, tracer and profiler are kept.
+        void Reset();
         void AdvanceEmulationStep() {
-            Emulate8080Operation(state);
+            Emulate8080Operation(&processor);
+        }
+        // Executes a batch of instructions on the selected backend and
+        // returns how many ran
+        uint32_t Run(uint32_t instructions);
+        // Executes until at least the given number of machine cycles have
+        // elapsed and returns the cycles actually run (the last instruction
+        // may overshoot the budget). Scheduled events are dispatched between
+        // batches, and a HLT with interrupts enabled idles until the next one.
+        uint64_t RunFor(uint64_t cycles);
+        // Executes until predicate(emulator) returns true, checked before
+        // every instruction (between native blocks on the JIT)
+        template<typename Predicate>
+        void RunUntil(Predicate predicate) {
+            Execute([this, &predicate](const State8080* cpu) { return predicate(*this); });
+        }
+
+        // Selecting BACKEND_JIT where no JIT exists falls back to the block
+        // cache; the backend actually selected is returned
+        Backend SetBackend(Backend selected);
+        Backend CurrentBackend() const { return backend; }
+        // Re-runs every native block on the interpreter and compares the
+        // results; a mismatching block is reported and left interpreted
+        void SetJitVerify(bool enabled) { jitVerify = enabled; }
+        uint64_t JitMismatches() const { return jitMismatches; }
+        uint64_t Instructions() const { return processor.instructions; }
+
+        Registers Snapshot() const {
+            Registers registers;
+            registers.a = processor.a; registers.b = processor.b; registers.c = processor.c;
+            registers.d = processor.d; registers.e = processor.e; registers.h = processor.h; registers.l = processor.l;
+            registers.flags = processor.flags_lazy ? (processor.flags & ~FLAGS_ZSP) | ZSP_TABLE.value[processor.zsp] : processor.flags;
+            registers.sp = processor.sp;
+            registers.pc = processor.pc;
+            registers.int_enable = processor.int_enable;
+            registers.halted = processor.halted;
+            registers.cycles = processor.cycles;
+            registers.instructions = processor.instructions;
+            return registers;
+        }
+        // The 64 KiB of memory behind the address space; mirrored ranges
+        // show up only at their source
+        const uint8_t* Memory() const { return processor.memory; }
+        // Reads through the memory map without side effects: pages mapped
+        // to a handler read as 0xff
+        uint8_t Peek(uint16_t address) const {
+            const uint8_t *page = readPages[address >> 8];
+            return page != nullptr ? page[address & 0xff] : 0xff;
         }
+
+        // Makes whole pages of the address space show the pages of a source
+        // range instead, repeating it through size
+        void MapMirror(uint16_t address, uint32_t size, uint16_t source, uint32_t sourceSize);
+        // Sends every access to whole pages of the address space to callbacks;
+        // an empty read handler reads 0xff and an empty write handler drops
+        // the store. Code run from them is decoded afresh every time.
+        void MapHandler(uint16_t address, uint32_t size, ReadHandler read, WriteHandler write);
+
+        // Save-state and rewind support (savestate.cpp, rewind.cpp)
+        MachineState CaptureMachine() const {
+            MachineState machine;
+            machine.registers = Snapshot();
+            machine.shiftValue = io.Get<ShiftRegister>().Value();
+            machine.shiftOffset = io.Get<ShiftRegister>().Offset();
+            return machine;
+        }
+        // Scheduled periodic events are realigned to the restored cycle count
+        void RestoreMachine(const MachineState& machine);
+        // Copies the pages stored to since the previous call into pages (a
+        // 256 bit map) and starts over
+        void TakeWrittenPages(uint64_t pages[PAGES / 64]) {
+            for (int i = 0; i < PAGES / 64; i++) {
+                pages[i] = writtenPages[i];
+                writtenPages[i] = 0;
+            }
+            // The next store to each page has to mark it again
+            for (int page = 0; page < PAGES; page++) writePages[page] = nullptr;
+        }
+        // Copies the pages stored to since Initialize or Reset into pages
+        // (a 256 bit map of the memory behind the address space)
+        void ModifiedPages(uint64_t pages[PAGES / 64]) const {
+            for (int i = 0; i < PAGES / 64; i++) pages[i] = modifiedPages[i];
+        }
+        // Replaces a whole page from outside the instruction stream. Cached
+        // code in it is invalidated, and it counts as written.
+        void RestorePage(uint8_t page, const uint8_t* data);
+        bool IsRomPage(uint8_t page) const { return pageAccess[page] == PAGE_ROM; }
+        // The memory image as the ROM set loaded it
+        const uint8_t* Pristine() const { return romSet->Pristine(); }
+        // Returns the video RAM lines that changed since the previous call
+        // (all of them the first time) and starts a new map
+        VideoDirtyMap TakeVideoDirty();
+        // Appends every memory store to log (nullptr to stop recording),
+        // stores to ROM and handlers included
+        void SetWriteLog(std::vector<MemoryWrite>* log) {
+            writeLog = log;
+            for (int page = 0; page < PAGES; page++) writePages[page] = nullptr;
+        }
+
+        uint16_t ProgramCounter() const { return processor.pc; }
+        uint64_t Cycles() const { return processor.cycles; }
+        // Tracing is only available in trace builds; production builds ignore
+        // it. The writer must be open, and stay open until detached with
+        // nullptr.
+        bool SetTraceWriter(TraceWriter* writer);
+        // Profiling is only available in profile builds; others ignore it.
+        // The profiler must outlive the emulator or be detached with nullptr.
+        bool SetProfiler(Profiler* profiler);
+
+        InvadersIo& Io() { return io; }
+        const InvadersIo& Io() const { return io; }
+        // Value the next IN instruction on this port reads (ports the shift
+        // register decodes excepted)
+        void SetInputPort(uint8_t port, uint8_t value) { io.Get<InputLatch>().Set(port, value); }
+
+        // Events driven by the cycle counter, dispatched by RunFor
+        EventScheduler& Events() { return events; }
+        // Requests RST n as an interrupting device would. It is taken between
+        // instructions only if interrupts are enabled, which also wakes a
+        // halted CPU; returns false if it was ignored.
+        bool Interrupt(uint8_t rst) {
+            if (!processor.int_enable) return false;
+            processor.int_enable = 0;
+            processor.halted = 0;
+            Restart(&processor, (rst & 7) * 8);
+            processor.cycles += OPCODE_CYCLES[0xc7];
+            return true;
+        }
+        bool InterruptsEnabled() const { return processor.int_enable != 0; }
+
+        // True while a HLT has stopped execution; only an interrupt resumes it
+        bool Halted() const { return processor.halted != 0; }
 };
 
 #endif
@@ -0,0 +1,63 @@
+#include "emulatorpool.h"
+
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+static const size_t PAGE_BYTES = 4096;
+static const size_t HUGE_PAGE_BYTES = 2 << 20;
+
+static size_t RoundUp(size_t value, size_t multiple) { return (value + multiple - 1) / multiple * multiple; }
+
+EmulatorPool::EmulatorPool(const RomSet& roms, size_t capacity) : roms(roms), capacity(capacity) {
+    // Memory first: it is page aligned, and so is the instance after it
+    slotSize = RoundUp(RomSet::MEMORY_SIZE + sizeof(Emulator8080), PAGE_BYTES);
+    arenaSize = RoundUp(capacity * slotSize, HUGE_PAGE_BYTES);
+
+    // Reserved huge pages if there are any, otherwise ask for transparent ones
+    void *mapping = mmap(nullptr, arenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    hugePagesRequested = mapping != MAP_FAILED;
+    if (!hugePagesRequested) {
+        mapping = mmap(nullptr, arenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED) {
+            printf("error: Couldn't map %zu emulator instances\n", capacity);
+            exit(1);
+        }
+        hugePagesRequested = madvise(mapping, arenaSize, MADV_HUGEPAGE) == 0;
+    }
+    arena = (uint8_t *)mapping;
+    released.reserve(capacity);
+}
+
+EmulatorPool::~EmulatorPool() {
+    for (size_t index = 0; index < constructed; index++)
+        ((Emulator8080 *)(Slot(index) + RomSet::MEMORY_SIZE))->~Emulator8080();
+    munmap(arena, arenaSize);
+}
+
+Emulator8080* EmulatorPool::Acquire() {
+    size_t index;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!released.empty()) {
+            Emulator8080 *emulator = released.back();
+            released.pop_back();
+            return emulator;
+        }
+        if (constructed == capacity) return nullptr;
+        index = constructed++;
+    }
+    // Constructed outside the lock; nothing else touches a slot before
+    // it is handed out
+    uint8_t *memory = Slot(index);
+    Emulator8080 *emulator = new (memory + RomSet::MEMORY_SIZE) Emulator8080();
+    emulator->Initialize(roms, memory);
+    return emulator;
+}
+
+void EmulatorPool::Release(Emulator8080* emulator) {
+    emulator->Reset();
+    std::lock_guard<std::mutex> guard(lock);
+    released.push_back(emulator);
+}
@@ -0,0 +1,52 @@
+#ifndef _EMULATORPOOL_H_
+#define _EMULATORPOOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+#include "emulator8080.h"
+#include "romset.h"
+
+// Fixed arena of emulator instances for running many short jobs on one ROM
+// set. Every slot is the instance's 64 KiB of memory followed by the
+// Emulator8080 itself, and all slots come from one mapping backed by huge
+// pages where the kernel has them, so a batch of instances costs a single
+// allocation and few TLB entries. Instances are constructed the first time
+// their slot is handed out; after that a released instance is Reset, which
+// only copies back the pages it stored to, instead of being rebuilt.
+class EmulatorPool {
+    public:
+        EmulatorPool(const RomSet& roms, size_t capacity);
+        ~EmulatorPool();
+        EmulatorPool(const EmulatorPool&) = delete;
+        EmulatorPool& operator=(const EmulatorPool&) = delete;
+
+        // A powered-on instance with no events scheduled, or null when every
+        // slot is in use; safe to call from several threads
+        Emulator8080* Acquire();
+        // Resets the instance and puts it back in the pool
+        void Release(Emulator8080* emulator);
+
+        size_t Capacity() const { return capacity; }
+        // True when the arena came from reserved huge pages or transparent
+        // ones were asked for; the kernel may still back a transparent
+        // request with 4 KiB pages
+        bool HugePagesRequested() const { return hugePagesRequested; }
+
+    private:
+        const RomSet& roms;
+        size_t capacity;
+        size_t slotSize = 0;
+        size_t arenaSize = 0;
+        uint8_t *arena = nullptr;
+        bool hugePagesRequested = false;
+
+        std::mutex lock;
+        size_t constructed = 0;                 // slots below this hold an instance
+        std::vector<Emulator8080*> released;
+
+        uint8_t* Slot(size_t index) const { return arena + index * slotSize; }
+};
+
+#endif
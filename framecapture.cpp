@@ -0,0 +1,193 @@
+#include "framecapture.h"
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+#include "renderer.h"
+#include "romset.h"
+#include "spaceinvaders.h"
+
+static const uint64_t PRIME64_1 = 0x9e3779b185ebca87ull;
+static const uint64_t PRIME64_2 = 0xc2b2ae3d27d4eb4full;
+static const uint64_t PRIME64_3 = 0x165667b19e3779f9ull;
+static const uint64_t PRIME64_4 = 0x85ebca77c2b2ae63ull;
+static const uint64_t PRIME64_5 = 0x27d4eb2f165667c5ull;
+
+static inline uint64_t RotateLeft(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+// Little endian loads; memcpy compiles to a plain load on x86
+static inline uint64_t Read64(const uint8_t* p) { uint64_t value; memcpy(&value, p, 8); return value; }
+static inline uint32_t Read32(const uint8_t* p) { uint32_t value; memcpy(&value, p, 4); return value; }
+
+static inline uint64_t Round(uint64_t accumulator, uint64_t input) {
+    return RotateLeft(accumulator + input * PRIME64_2, 31) * PRIME64_1;
+}
+
+static inline uint64_t MergeRound(uint64_t hash, uint64_t accumulator) {
+    return (hash ^ Round(0, accumulator)) * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t XxHash64(const uint8_t* data, size_t size, uint64_t seed) {
+    const uint8_t *p = data, *end = data + size;
+    uint64_t hash;
+    if (size >= 32) {
+        // Four independent lanes over 32 byte stripes
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2, v2 = seed + PRIME64_2, v3 = seed, v4 = seed - PRIME64_1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = Round(v1, Read64(p));
+            v2 = Round(v2, Read64(p + 8));
+            v3 = Round(v3, Read64(p + 16));
+            v4 = Round(v4, Read64(p + 24));
+        }
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        hash = MergeRound(hash, v1);
+        hash = MergeRound(hash, v2);
+        hash = MergeRound(hash, v3);
+        hash = MergeRound(hash, v4);
+    } else {
+        hash = seed + PRIME64_5;
+    }
+    hash += size;
+
+    for (; p + 8 <= end; p += 8) hash = RotateLeft(hash ^ Round(0, Read64(p)), 27) * PRIME64_1 + PRIME64_4;
+    if (p + 4 <= end) {
+        hash = RotateLeft(hash ^ (Read32(p) * PRIME64_1), 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; p++) hash = RotateLeft(hash ^ (*p * PRIME64_5), 11) * PRIME64_1;
+
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+FrameCapture::FrameCapture(Emulator8080& emulator) : emulator(emulator), origin(emulator.Cycles()) {
+    emulator.Events().SchedulePeriodic(origin + ScanlineCycle(VBLANK_SCANLINE), CYCLES_PER_FRAME, [this] { VBlank(); });
+}
+
+FrameCapture::~FrameCapture() {
+    if (output != NULL) fclose(output);
+}
+
+bool FrameCapture::OpenOutput(const char* path) {
+    if (output != NULL) fclose(output);
+    output = fopen(path, "w");
+    if (output == NULL) {
+        printf("error: Couldn't create hash file %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+bool FrameCapture::LoadGolden(const char* path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        printf("error: Couldn't open golden hash file %s\n", path);
+        return false;
+    }
+    golden.clear();
+    char line[128];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file)) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        unsigned long long frame, hash;
+        int fields = sscanf(line, "%llu %llx", &frame, &hash);
+        if (fields <= 0) continue;
+        if (fields != 2) {
+            printf("error: %s:%d: expected 'frame hash'\n", path, lineNumber);
+            fclose(file);
+            return false;
+        }
+        golden[frame] = hash;
+    }
+    fclose(file);
+    return true;
+}
+
+void FrameCapture::VBlank() {
+    // A restore can move the cycle counter back past where capture began
+    if (emulator.Cycles() < origin) return;
+    uint64_t frame = (emulator.Cycles() - origin) / CYCLES_PER_FRAME;
+    uint64_t hash = XxHash64(emulator.Memory() + VIDEO_START, VIDEO_BYTES);
+    frames++;
+    if (output != NULL) fprintf(output, "%llu %016llx\n", (unsigned long long)frame, (unsigned long long)hash);
+
+    auto expected = golden.find(frame);
+    if (expected == golden.end() || expected->second == hash) return;
+    if (mismatches++ == 0) firstMismatch = frame;
+    if (!dumpPrefix.empty() && dumped < dumpLimit) {
+        char name[32];
+        snprintf(name, sizeof(name), "%06llu.png", (unsigned long long)frame);
+        if (WritePng((dumpPrefix + name).c_str(), emulator.Memory())) dumped++;
+    }
+}
+
+// PNG chunk: big endian length, type, data, CRC-32 of type and data
+static void PutChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data) {
+    uint32_t length = data.size();
+    uint8_t header[8] = { (uint8_t)(length >> 24), (uint8_t)(length >> 16), (uint8_t)(length >> 8), (uint8_t)length };
+    memcpy(header + 4, type, 4);
+    png.insert(png.end(), header, header + 8);
+    size_t start = png.size() - 4;
+    png.insert(png.end(), data.begin(), data.end());
+    uint32_t crc = RomSet::Crc32(png.data() + start, png.size() - start);
+    uint8_t trailer[4] = { (uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc };
+    png.insert(png.end(), trailer, trailer + 4);
+}
+
+bool FrameCapture::WritePng(const char* path, const uint8_t* memory) {
+    Renderer renderer;
+    renderer.Render(memory);
+    const uint32_t *pixels = renderer.Frame();
+
+    // Rows of a filter byte (none) and one grey byte per pixel
+    std::vector<uint8_t> raw;
+    raw.reserve(Renderer::HEIGHT * (Renderer::WIDTH + 1));
+    for (int y = 0; y < Renderer::HEIGHT; y++) {
+        raw.push_back(0);
+        for (int x = 0; x < Renderer::WIDTH; x++) raw.push_back(pixels[y * Renderer::WIDTH + x] == Renderer::PIXEL_ON ? 0xff : 0x00);
+    }
+
+    // zlib stream of stored deflate blocks: no compressor needed and the
+    // frames are only written for the few that mismatch
+    std::vector<uint8_t> zlib = { 0x78, 0x01 };
+    for (size_t offset = 0; offset < raw.size();) {
+        size_t length = std::min<size_t>(raw.size() - offset, 0xffff);
+        bool last = offset + length == raw.size();
+        uint8_t block[5] = { (uint8_t)last, (uint8_t)length, (uint8_t)(length >> 8), (uint8_t)~length, (uint8_t)(~length >> 8) };
+        zlib.insert(zlib.end(), block, block + 5);
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+        offset += length;
+    }
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    uint32_t adler = (b << 16) | a;
+    uint8_t checksum[4] = { (uint8_t)(adler >> 24), (uint8_t)(adler >> 16), (uint8_t)(adler >> 8), (uint8_t)adler };
+    zlib.insert(zlib.end(), checksum, checksum + 4);
+
+    // 8 bit greyscale, default compression and filtering, not interlaced
+    std::vector<uint8_t> header = { 0, 0, Renderer::WIDTH >> 8, Renderer::WIDTH & 0xff,
+                                    0, 0, Renderer::HEIGHT >> 8, Renderer::HEIGHT & 0xff, 8, 0, 0, 0, 0 };
+    std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    PutChunk(png, "IHDR", header);
+    PutChunk(png, "IDAT", zlib);
+    PutChunk(png, "IEND", {});
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        printf("error: Couldn't create %s\n", path);
+        return false;
+    }
+    bool ok = fwrite(png.data(), 1, png.size(), file) == png.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok) printf("error: Couldn't write %s\n", path);
+    return ok;
+}
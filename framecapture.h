@@ -0,0 +1,70 @@
+#ifndef _FRAMECAPTURE_H_
+#define _FRAMECAPTURE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include "emulator8080.h"
+#include "videoram.h"
+
+// XXH64 of size bytes; matches the reference xxHash implementation
+uint64_t XxHash64(const uint8_t* data, size_t size, uint64_t seed = 0);
+
+// Headless frame capture for golden-image regression. At every VBlank the
+// 7 KiB of video RAM is hashed, which is all a frame is, so a run is
+// checked frame by frame without rendering anything. Hashes stream out as
+// text as they are taken, one per frame:
+//
+//     frame  hash
+//     0      3c6e9f1a0d2b7e45
+//
+// A hash file from a known good run is the golden reference for the next
+// one; frames whose hash differs are counted and, if a dump prefix is set,
+// rendered to PNG so only the frames worth looking at cost any disk.
+class FrameCapture {
+    public:
+        static const uint16_t VIDEO_START = VideoDirtyMap::START;
+        static const size_t VIDEO_BYTES = VideoDirtyMap::LINES * VideoDirtyMap::LINE_BYTES;
+
+        // Hashes every frame from the one that begins at the emulator's
+        // current cycle, which is frame 0. The emulator must not run after
+        // the capture is destroyed.
+        explicit FrameCapture(Emulator8080& emulator);
+        ~FrameCapture();
+        FrameCapture(const FrameCapture&) = delete;
+        FrameCapture& operator=(const FrameCapture&) = delete;
+
+        // Streams every hash to path; prints the reason on failure
+        bool OpenOutput(const char* path);
+        // Compares every frame against a hash file; frames it does not
+        // cover are not checked
+        bool LoadGolden(const char* path);
+        // Writes mismatching frames as <prefix><frame>.png, at most limit of them
+        void SetDumpPrefix(const std::string& prefix, int limit = 16) { dumpPrefix = prefix; dumpLimit = limit; }
+
+        uint64_t Frames() const { return frames; }
+        uint64_t Mismatches() const { return mismatches; }
+        // Frame of the first mismatch, only meaningful when there was one
+        uint64_t FirstMismatch() const { return firstMismatch; }
+
+        // 224x256 8 bit greyscale PNG of the frame in a 64 KiB memory image
+        static bool WritePng(const char* path, const uint8_t* memory);
+
+    private:
+        Emulator8080& emulator;
+        uint64_t origin;
+        FILE *output = NULL;
+        std::unordered_map<uint64_t, uint64_t> golden;
+        std::string dumpPrefix;
+        int dumpLimit = 0;
+        int dumped = 0;
+        uint64_t frames = 0;
+        uint64_t mismatches = 0;
+        uint64_t firstMismatch = 0;
+
+        void VBlank();
+};
+
+#endif
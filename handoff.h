@@ -0,0 +1,72 @@
+#ifndef _HANDOFF_H_
+#define _HANDOFF_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free structures for handing data between exactly two threads.
+
+// Triple buffer: the producer always has a back slot to fill and the
+// consumer always has a front slot to read, so neither ever waits. Publish
+// swaps the back slot with the shared middle one, and Acquire swaps the
+// front slot with the middle when it holds something newer. Frames the
+// consumer is too slow to take are overwritten; the newest one always wins.
+template<typename T>
+class TripleBuffer {
+    public:
+        // Producer side
+        T& Back() { return slots[back]; }
+        int BackIndex() const { return back; }
+        void Publish() {
+            back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+        }
+
+        // Consumer side: returns false if nothing was published since the
+        // last Acquire, leaving Front() unchanged
+        bool Acquire() {
+            if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+            return true;
+        }
+        const T& Front() const { return slots[front]; }
+
+    private:
+        static const uint8_t INDEX = 0x03;
+        static const uint8_t FRESH = 0x04;
+
+        T slots[3];
+        int back = 0;
+        int front = 1;
+        std::atomic<uint8_t> middle{2};
+};
+
+// Bounded single-producer single-consumer queue. Capacity must be a power
+// of two; Push fails rather than blocks when the queue is full.
+template<typename T, size_t Capacity>
+class SpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+    public:
+        bool Push(const T& item) {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) == Capacity) return false;
+            items[h & (Capacity - 1)] = item;
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+        bool Pop(T& item) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t == head.load(std::memory_order_acquire)) return false;
+            item = items[t & (Capacity - 1)];
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        T items[Capacity];
+        // Each index is written by one side only; keep them on separate lines
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+};
+
+#endif
@@ -0,0 +1,231 @@
+#include "inputlog.h"
+
+#include <string.h>
+#include "savestate.h"
+#include "spaceinvaders.h"
+
+static const char MAGIC[8] = { '8', '0', '8', '0', 'I', 'N', 'P', 'T' };
+static const size_t HEADER_BYTES = sizeof(MAGIC) + 4 + 4 + 8;
+static const uint8_t KIND_KEYFRAME = 0;
+static const uint8_t KIND_PORT1 = 1;
+static const uint8_t KIND_PORT2 = 2;
+static const uint8_t INPUT_PORTS[2] = { 1, 2 };
+
+static bool GetVarint(const std::vector<uint8_t>& data, size_t end, size_t& offset, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && offset < end; shift += 7) {
+        uint8_t byte = data[offset++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static uint64_t GetLittleEndian(const uint8_t* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) value = (value << 8) | in[i];
+    return value;
+}
+
+bool InputRecorder::Open(const char* path, uint32_t keyframeInterval) {
+    Close();
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        printf("error: Couldn't create %s\n", path);
+        return false;
+    }
+    interval = keyframeInterval == 0 ? KEYFRAME_INTERVAL : keyframeInterval;
+    frame = recordFrame = 0;
+    return true;
+}
+
+void InputRecorder::PutVarint(uint64_t value) {
+    uint8_t bytes[10];
+    int count = 0;
+    do {
+        bytes[count++] = (value & 0x7f) | (value >= 0x80 ? 0x80 : 0);
+        value >>= 7;
+    } while (value != 0);
+    fwrite(bytes, 1, count, file);
+}
+
+void InputRecorder::PutRecord(uint64_t at, uint8_t kind) {
+    PutVarint(((at - recordFrame) << 2) | kind);
+    recordFrame = at;
+}
+
+void InputRecorder::Frame(const Emulator8080& emulator) {
+    if (file == NULL) return;
+    const InputLatch& latch = emulator.Io().Get<InputLatch>();
+    if (frame == 0) {
+        uint8_t header[HEADER_BYTES];
+        memcpy(header, MAGIC, sizeof(MAGIC));
+        uint64_t fields[] = { INPUT_LOG_VERSION, interval, emulator.Cycles() };
+        int widths[] = { 4, 4, 8 };
+        uint8_t *p = header + sizeof(MAGIC);
+        for (int i = 0; i < 3; i++)
+            for (int b = 0; b < widths[i]; b++) *p++ = fields[i] >> (8 * b);
+        fwrite(header, 1, sizeof(header), file);
+        // Frame 0's input is part of its keyframe
+        for (int i = 0; i < 2; i++) ports[i] = latch.Get(INPUT_PORTS[i]);
+    }
+
+    uint8_t kind = 0, masks[2];
+    for (int i = 0; i < 2; i++) {
+        masks[i] = latch.Get(INPUT_PORTS[i]) ^ ports[i];
+        if (masks[i] != 0) kind |= i == 0 ? KIND_PORT1 : KIND_PORT2;
+        ports[i] ^= masks[i];
+    }
+    if (kind != 0) {
+        PutRecord(frame, kind);
+        if (kind & KIND_PORT1) fputc(masks[0], file);
+        if (kind & KIND_PORT2) fputc(masks[1], file);
+    }
+
+    if (frame % interval == 0) {
+        std::vector<uint8_t> state;
+        SaveState::Save(emulator, state);
+        PutRecord(frame, KIND_KEYFRAME);
+        PutVarint(state.size());
+        fwrite(state.data(), 1, state.size(), file);
+    }
+    frame++;
+}
+
+void InputRecorder::Close() {
+    if (file == NULL) return;
+    if (frame > 0) {
+        PutRecord(frame, KIND_KEYFRAME);
+        PutVarint(0);
+    }
+    if (fclose(file) != 0) printf("error: Couldn't finish writing the input log\n");
+    file = NULL;
+}
+
+bool InputPlayer::ReadRecord(size_t& offset, uint64_t& at, uint8_t& kind, uint8_t mask[2], size_t& state, size_t& size) const {
+    uint64_t header, length = 0;
+    size_t next = offset;
+    if (!GetVarint(log, end, next, header)) return false;
+    kind = header & 3;
+    at = recordFrame + (header >> 2);
+    if (kind == KIND_KEYFRAME) {
+        if (!GetVarint(log, end, next, length) || length == 0 || length > end - next) return false;
+        state = next;
+        size = length;
+        next += length;
+    } else {
+        size_t bytes = ((kind & KIND_PORT1) ? 1 : 0) + ((kind & KIND_PORT2) ? 1 : 0);
+        if (bytes > end - next) return false;
+        mask[0] = (kind & KIND_PORT1) ? log[next++] : 0;
+        mask[1] = (kind & KIND_PORT2) ? log[next++] : 0;
+    }
+    offset = next;
+    return true;
+}
+
+bool InputPlayer::Open(const char* path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("error: Couldn't open %s\n", path);
+        return false;
+    }
+    log.clear();
+    uint8_t buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) log.insert(log.end(), buffer, buffer + read);
+    fclose(file);
+
+    if (log.size() < HEADER_BYTES || memcmp(log.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        printf("error: %s is not an input log\n", path);
+        return false;
+    }
+    uint32_t version = GetLittleEndian(&log[8], 4);
+    if (version != INPUT_LOG_VERSION) {
+        printf("error: %s is input log version %u, this build reads version %u\n", path, version, INPUT_LOG_VERSION);
+        return false;
+    }
+    startCycle = GetLittleEndian(&log[16], 8);
+
+    // One pass to find the keyframes and where the records stop; a log that
+    // was cut short ends at its last complete record
+    keyframes.clear();
+    end = log.size();
+    size_t offset = HEADER_BYTES;
+    recordFrame = 0;
+    uint64_t at;
+    uint8_t kind, mask[2];
+    size_t state = 0, size = 0;
+    while (ReadRecord(offset, at, kind, mask, state, size)) {
+        recordFrame = at;
+        if (kind == KIND_KEYFRAME) keyframes.push_back({at, state, size, offset});
+    }
+    end = offset;
+    frames = recordFrame + 1;
+    // The end record is a zero-length keyframe, which ReadRecord stops at
+    uint64_t header, length;
+    size_t tail = offset;
+    if (GetVarint(log, log.size(), tail, header) && (header & 3) == KIND_KEYFRAME &&
+        GetVarint(log, log.size(), tail, length) && length == 0)
+        frames = recordFrame + (header >> 2);
+    if (keyframes.empty() || keyframes[0].frame != 0) {
+        printf("error: %s has no starting keyframe\n", path);
+        return false;
+    }
+    position = keyframes[0].next;
+    recordFrame = frame = 0;
+    return true;
+}
+
+bool InputPlayer::IsInputLog(const char* path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+    char magic[sizeof(MAGIC)];
+    bool matches = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+    fclose(file);
+    return matches;
+}
+
+bool InputPlayer::Seek(Emulator8080& emulator, uint64_t target) {
+    // Keyframes are in frame order and already hold their frame's input
+    size_t k = 0;
+    while (k + 1 < keyframes.size() && keyframes[k + 1].frame <= target) k++;
+    const Keyframe& keyframe = keyframes[k];
+    if (!SaveState::Load(emulator, &log[keyframe.state], keyframe.size)) return false;
+    position = keyframe.next;
+    recordFrame = frame = keyframe.frame;
+    while (frame < target) {
+        if (!Step(emulator)) return false;
+    }
+    return true;
+}
+
+bool InputPlayer::Step(Emulator8080& emulator) {
+    uint64_t frameEnd = StartFrame(emulator);
+    if (frameEnd > emulator.Cycles()) emulator.RunFor(frameEnd - emulator.Cycles());
+    return FinishFrame(emulator);
+}
+
+uint64_t InputPlayer::StartFrame(Emulator8080& emulator) {
+    InputLatch& latch = emulator.Io().Get<InputLatch>();
+    uint64_t at;
+    uint8_t kind, mask[2];
+    size_t state, size;
+    size_t next = position;
+    while (ReadRecord(next, at, kind, mask, state, size) && at == frame) {
+        // A keyframe reached in sequence matches the state already here
+        if (kind != KIND_KEYFRAME) {
+            for (int i = 0; i < 2; i++) latch.Set(INPUT_PORTS[i], latch.Get(INPUT_PORTS[i]) ^ mask[i]);
+        }
+        position = next;
+        recordFrame = at;
+    }
+
+    // Frame boundaries fall where they did in the recording, whatever the
+    // last instruction of a frame overshot by
+    return startCycle + (frame + 1) * CYCLES_PER_FRAME;
+}
+
+bool InputPlayer::FinishFrame(const Emulator8080& emulator) {
+    frame++;
+    return !(emulator.Halted() && !emulator.InterruptsEnabled());
+}
@@ -0,0 +1,103 @@
+#ifndef _INPUTLOG_H_
+#define _INPUTLOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "emulator8080.h"
+
+// Input logs: the player inputs of a run, frame by frame, plus a save-state
+// every so many frames, so a recorded run can be replayed exactly and
+// entered at any frame.
+//
+//     "8080INPT"  u32 version  u32 keyframe interval  u64 cycle frame 0 starts at
+//     records...
+//
+// A record starts with varint((frames since the previous record << 2) | kind).
+// Kind bits 1 and 2 mean an XOR mask for port 1 and port 2 follows, applied
+// at the start of that frame; frames where nothing changes cost nothing.
+// Kind 0 is a keyframe, varint(size) and a save-state taken at the start of
+// the frame once its input is applied, or with size 0 the end of the log. Records are
+// appended as the run goes, so a log cut short still replays up to where it
+// stops.
+const uint32_t INPUT_LOG_VERSION = 1;
+const uint32_t KEYFRAME_INTERVAL = 600; // frames, 10 s at 60 Hz
+
+class InputRecorder {
+    public:
+        InputRecorder() {}
+        ~InputRecorder() { Close(); }
+        InputRecorder(const InputRecorder&) = delete;
+        InputRecorder& operator=(const InputRecorder&) = delete;
+
+        bool Open(const char* path, uint32_t keyframeInterval = KEYFRAME_INTERVAL);
+        // Call at the start of every frame, once that frame's input is in
+        // the latch and before it runs
+        void Frame(const Emulator8080& emulator);
+        // Writes the end record; the log is complete after this
+        void Close();
+        bool Recording() const { return file != NULL; }
+        uint64_t Frames() const { return frame; }
+
+    private:
+        FILE *file = NULL;
+        uint32_t interval = KEYFRAME_INTERVAL;
+        uint64_t frame = 0;
+        uint64_t recordFrame = 0;   // frame of the last record written
+        uint8_t ports[2] = {};      // ports 1 and 2 as of the last record
+
+        void PutRecord(uint64_t at, uint8_t kind);
+        void PutVarint(uint64_t value);
+};
+
+// Replays a log on an emulator set up the way the recording one was: same
+// ROM set, and video interrupts scheduled from cycle 0.
+class InputPlayer {
+    public:
+        // Reads and indexes the whole log; prints the reason on failure
+        bool Open(const char* path);
+        static bool IsInputLog(const char* path);
+
+        // Leaves the emulator at the start of the given frame: loads the
+        // closest keyframe at or before it and replays at most one keyframe
+        // interval from there
+        bool Seek(Emulator8080& emulator, uint64_t frame);
+        // Applies the current frame's input and runs it. Past the end of
+        // the log frames keep running with the last input. Returns false once
+        // the CPU has halted with interrupts disabled.
+        bool Step(Emulator8080& emulator);
+        // Step in two halves, for callers that run the frame themselves:
+        // StartFrame applies the frame's input and returns the cycle the
+        // frame ends at, and FinishFrame moves on once the emulator has run
+        // to it or stopped
+        uint64_t StartFrame(Emulator8080& emulator);
+        bool FinishFrame(const Emulator8080& emulator);
+
+        uint64_t Frame() const { return frame; }
+        // Frames covered by the log
+        uint64_t Frames() const { return frames; }
+
+    private:
+        struct Keyframe {
+            uint64_t frame;
+            size_t   state;     // offset and size of the save-state
+            size_t   size;
+            size_t   next;      // offset of the record after it
+        };
+
+        std::vector<uint8_t> log;
+        std::vector<Keyframe> keyframes;
+        uint64_t startCycle = 0;
+        uint64_t frames = 0;
+        size_t end = 0;             // offset the records stop at
+
+        size_t position = 0;        // next record to read
+        uint64_t recordFrame = 0;   // frame of the last record read
+        uint64_t frame = 0;         // frame Step runs next
+
+        // Decodes the record at offset; false at the end of the log
+        bool ReadRecord(size_t& offset, uint64_t& at, uint8_t& kind, uint8_t mask[2], size_t& state, size_t& size) const;
+};
+
+#endif
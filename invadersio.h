@@ -0,0 +1,43 @@
+#ifndef _INVADERSIO_H_
+#define _INVADERSIO_H_
+
+#include <stdint.h>
+#include "iobus.h"
+
+// The Space Invaders board's external shift register (MB14241). The game
+// draws every sprite through it, so it stays a few inline operations.
+//   OUT 2: shift amount (low 3 bits)
+//   OUT 4: shifts the data byte in from the top of the 16 bit register
+//   IN 3:  the 8 bits at the shift amount, counting down from the top
+class ShiftRegister {
+    public:
+        static bool ReadsPort(uint8_t port) { return port == 3; }
+        static bool WritesPort(uint8_t port) { return port == 2 || port == 4; }
+        uint8_t In(uint8_t port) const { return (value >> (8 - offset)) & 0xff; }
+        void Out(uint8_t port, uint8_t data) {
+            if (port == 2) offset = data & 7;
+            else value = (data << 8) | (value >> 8);
+        }
+
+        uint16_t Value() const { return value; }
+        uint8_t Offset() const { return offset; }
+        void Restore(uint16_t data, uint8_t shift) { value = data; offset = shift & 7; }
+
+    private:
+        uint16_t value = 0;
+        uint8_t offset = 0;
+};
+
+// Input port 1 (coin, start buttons, player 1 controls) and port 2 (DIP
+// switches, player 2 controls) read from the latch; bit 3 of port 1 is tied
+// high on the board. Sound (OUT 3 and 5) and the watchdog (OUT 6) are not
+// emulated, so those writes are dropped.
+typedef IoBus<ShiftRegister, InputLatch> InvadersIo;
+
+inline InvadersIo MakeInvadersIo() {
+    InputLatch inputs;
+    inputs.Set(1, 0x08);
+    return InvadersIo(ShiftRegister(), inputs);
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef _IOBUS_H_
+#define _IOBUS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tuple>
+#include <type_traits>
+
+// I/O port bus for IN and OUT. The devices on the bus are fixed at compile
+// time and handed over at construction; each device type answers
+// ReadsPort/WritesPort for the ports it decodes. IN and OUT try the devices
+// in order through an inlined chain of port tests, so the instruction path
+// has no indirect or virtual call. Reads nobody decodes float high and
+// unclaimed writes are dropped.
+//
+// A device provides:
+//     static bool ReadsPort(uint8_t port);  uint8_t In(uint8_t port);
+//     static bool WritesPort(uint8_t port); void Out(uint8_t port, uint8_t value);
+template<typename... Devices>
+class IoBus {
+    public:
+        IoBus() {}
+        explicit IoBus(Devices... devices) : devices(devices...) {}
+
+        uint8_t In(uint8_t port) { return InFrom<0>(port); }
+        void Out(uint8_t port, uint8_t value) { OutTo<0>(port, value); }
+
+        template<typename Device> Device& Get() { return std::get<Device>(devices); }
+        template<typename Device> const Device& Get() const { return std::get<Device>(devices); }
+
+    private:
+        std::tuple<Devices...> devices;
+
+        template<size_t I>
+        typename std::enable_if<(I < sizeof...(Devices)), uint8_t>::type InFrom(uint8_t port) {
+            auto& device = std::get<I>(devices);
+            if (device.ReadsPort(port)) return device.In(port);
+            return InFrom<I + 1>(port);
+        }
+        template<size_t I>
+        typename std::enable_if<(I == sizeof...(Devices)), uint8_t>::type InFrom(uint8_t port) { return 0xff; }
+
+        template<size_t I>
+        typename std::enable_if<(I < sizeof...(Devices))>::type OutTo(uint8_t port, uint8_t value) {
+            auto& device = std::get<I>(devices);
+            if (device.WritesPort(port)) device.Out(port, value);
+            else OutTo<I + 1>(port, value);
+        }
+        template<size_t I>
+        typename std::enable_if<(I == sizeof...(Devices))>::type OutTo(uint8_t port, uint8_t value) {}
+};
+
+// Input latch: IN returns whatever the host last set for the port. Placed
+// last on a bus it answers every read the other devices leave.
+class InputLatch {
+    public:
+        static bool ReadsPort(uint8_t port) { return true; }
+        static bool WritesPort(uint8_t port) { return false; }
+        uint8_t In(uint8_t port) const { return values[port]; }
+        void Out(uint8_t port, uint8_t value) {}
+
+        void Set(uint8_t port, uint8_t value) { values[port] = value; }
+        uint8_t Get(uint8_t port) const { return values[port]; }
+
+    private:
+        uint8_t values[256] = {};
+};
+
+#endif
@@ -0,0 +1,785 @@
+#include "emulator8080.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+// x86-64 translation of hot basic blocks. The seven 8080 registers are
+// pinned to r8b (A) and r9b-r14b (B, C, D, E, H, L) for the whole native run:
+// the prologue loads them from State8080, the epilogue stores them back
+// together with pc, cycles and the instruction count. The state pointer stays
+// in rdi (System V calling convention), so only hosts using that ABI get a JIT.
+//
+// Every instruction but IN and OUT is translated. Memory goes through the
+// emulator's page tables the way ReadMemory and WriteMemory do, with the
+// table base addressed from rdi. An access the interpreter would send down
+// the slow path (a handler page, or a store to ROM, to a page holding cached
+// code or to one not yet marked written) leaves native code before the
+// instruction changes anything, as do IN and OUT; the interpreter carries
+// on from there, which keeps self-modifying code detection and I/O on the
+// interpreter path. ALU results set flags lazily like the interpreter's: CY
+// and AC in the packed flags, S, Z and P from the result in zsp.
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define EMULATOR8080_HAS_JIT 1
+#include <sys/mman.h>
+#endif
+
+#ifdef EMULATOR8080_HAS_JIT
+
+static const size_t HOST_PAGE_SIZE = 4096;
+
+enum { RAX = 0, RCX = 1, RDX = 2, RSI = 6, RDI = 7 };
+
+// Host register numbers for the 8080 register field of an opcode
+// (B, C, D, E, H, L, M, A); -1 marks M, which lives in memory
+static const int HOST_REGISTER[8] = { 9, 10, 11, 12, 13, 14, -1, 8 };
+static const int HOST_A = 8, HOST_H = 13, HOST_L = 14;
+static const int PAIR_HIGH[3] = { 9, 11, 13 }; // B, D, H
+static const int PAIR_LOW[3] = { 10, 12, 14 }; // C, E, L
+
+// Condition codes of Jcc and SETcc
+enum { CC_C = 0x2, CC_Z = 0x4, CC_NZ = 0x5, CC_S = 0x8, CC_P = 0xa };
+
+class X86Emitter {
+    public:
+        X86Emitter(uint8_t* buffer, size_t capacity) : code(buffer), capacity(capacity) {}
+
+        size_t Size() const { return size; }
+        bool Overflowed() const { return overflow; }
+
+        void Byte(uint8_t value) {
+            if (size < capacity) code[size] = value;
+            else overflow = true;
+            size++;
+        }
+        void Word(uint16_t value) { Byte(value & 0xff); Byte(value >> 8); }
+        void Dword(uint32_t value) { Word(value & 0xffff); Word(value >> 16); }
+        void Qword(uint64_t value) { Dword(value & 0xffffffff); Dword(value >> 32); }
+
+        // Byte forms always carry a REX prefix, so register numbers 4-7 mean
+        // spl-dil rather than ah-bh
+        void Rex(bool wide, int reg, int index, int base) { Byte(0x40 | (wide << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3)); }
+        void RegisterOperand(int reg, int rm) { Byte(0xc0 | ((reg & 7) << 3) | (rm & 7)); }
+        // [rdi+offset]
+        void StateOperand(int reg, uint8_t offset) { Byte(0x47 | ((reg & 7) << 3)); Byte(offset); }
+
+        void MovRegReg(int dst, int src) { AluRegReg(0x88, dst, src); }
+        void MovRegImm(int dst, uint8_t value) { Rex(false, 0, 0, dst); Byte(0xb0 + (dst & 7)); Byte(value); }
+        void LoadReg(int dst, uint8_t offset) { Rex(false, dst, 0, 0); Byte(0x8a); StateOperand(dst, offset); }
+        void StoreReg(uint8_t offset, int src) { Rex(false, src, 0, 0); Byte(0x88); StateOperand(src, offset); }
+        // 80 /ext ib on a register
+        void AluRegImm(int ext, int dst, uint8_t value) { Rex(false, 0, 0, dst); Byte(0x80); RegisterOperand(ext, dst); Byte(value); }
+        // op r/m8, r8 (add 00, or 08, adc 10, sbb 18, and 20, sub 28, xor 30, test 84, xchg 86, mov 88)
+        void AluRegReg(uint8_t opcode, int dst, int src) { Rex(false, src, 0, dst); Byte(opcode); RegisterOperand(src, dst); }
+        void NotReg(int dst) { Rex(false, 0, 0, dst); Byte(0xf6); RegisterOperand(2, dst); }
+        void TestRegImm(int dst, uint8_t value) { Rex(false, 0, 0, dst); Byte(0xf6); RegisterOperand(0, dst); Byte(value); }
+        // inc /0, dec /1
+        void IncDecReg(int ext, int dst) { Rex(false, 0, 0, dst); Byte(0xfe); RegisterOperand(ext, dst); }
+        // d0 /ext: rol 0, ror 1, rcl 2, rcr 3, shl 4, shr 5 by one
+        void ShiftReg(int ext, int dst) { Rex(false, 0, 0, dst); Byte(0xd0); RegisterOperand(ext, dst); }
+        void ShiftRegImm(int ext, int dst, uint8_t count) { Rex(false, 0, 0, dst); Byte(0xc0); RegisterOperand(ext, dst); Byte(count); }
+        void Setcc(int cc, int dst) { Rex(false, 0, 0, dst); Byte(0x0f); Byte(0x90 + cc); RegisterOperand(0, dst); }
+        // 80 /ext ib on byte [rdi+offset]
+        void AluMemImm(int ext, uint8_t offset, uint8_t value) { Byte(0x80); StateOperand(ext, offset); Byte(value); }
+        // op [rdi+offset], r8 (or 08, and 20)
+        void AluMemReg(uint8_t opcode, uint8_t offset, int src) { Rex(false, src, 0, 0); Byte(opcode); StateOperand(src, offset); }
+        void MovMemImm8(uint8_t offset, uint8_t value) { Byte(0xc6); StateOperand(0, offset); Byte(value); }
+        void MovMemImm16(uint8_t offset, uint16_t value) { Byte(0x66); Byte(0xc7); StateOperand(0, offset); Word(value); }
+        // 66 83 /ext ib on word [rdi+offset]
+        void AluMem16Imm(int ext, uint8_t offset, uint8_t value) { Byte(0x66); Byte(0x83); StateOperand(ext, offset); Byte(value); }
+        // REX.W 81 /0 id on qword [rdi+offset]
+        void AddMem64Imm(uint8_t offset, uint32_t value) { Byte(0x48); Byte(0x81); StateOperand(0, offset); Dword(value); }
+
+        // 32 bit forms, for addresses
+        void MovzxReg8(int dst, int src) { Rex(false, dst, 0, src); Byte(0x0f); Byte(0xb6); RegisterOperand(dst, src); }
+        void MovzxReg16(int dst, int src) { Rex(false, dst, 0, src); Byte(0x0f); Byte(0xb7); RegisterOperand(dst, src); }
+        void MovzxMem16(int dst, uint8_t offset) { Rex(false, dst, 0, 0); Byte(0x0f); Byte(0xb7); StateOperand(dst, offset); }
+        void StoreReg16(uint8_t offset, int src) { Byte(0x66); Rex(false, src, 0, 0); Byte(0x89); StateOperand(src, offset); }
+        void MovReg32Imm(int dst, uint32_t value) { Rex(false, 0, 0, dst); Byte(0xb8 + (dst & 7)); Dword(value); }
+        // op r/m32, r32 (add 01, or 09, mov 89)
+        void AluReg32(uint8_t opcode, int dst, int src) { Rex(false, src, 0, dst); Byte(opcode); RegisterOperand(src, dst); }
+        void AluReg32Imm(int ext, int dst, uint32_t value) { Rex(false, 0, 0, dst); Byte(0x81); RegisterOperand(ext, dst); Dword(value); }
+        // c1 /ext ib: shl 4, shr 5
+        void ShiftReg32(int ext, int dst, uint8_t count) { Rex(false, 0, 0, dst); Byte(0xc1); RegisterOperand(ext, dst); Byte(count); }
+
+        // 64 bit forms, for pointers
+        // mov dst, [rdi + index*8 + offset]
+        void LoadTableEntry(int dst, int index, int32_t offset) {
+            Rex(true, dst, index, RDI); Byte(0x8b); Byte(0x84 | ((dst & 7) << 3)); Byte(0xc0 | ((index & 7) << 3) | RDI); Dword(offset);
+        }
+        void TestReg64(int reg) { Rex(true, reg, 0, reg); Byte(0x85); RegisterOperand(reg, reg); }
+        void AddReg64(int dst, int src) { Rex(true, src, 0, dst); Byte(0x01); RegisterOperand(src, dst); }
+        void MovReg64(int dst, int src) { Rex(true, src, 0, dst); Byte(0x89); RegisterOperand(src, dst); }
+        void MovReg64Imm(int dst, uint64_t value) { Rex(true, 0, 0, dst); Byte(0xb8 + (dst & 7)); Qword(value); }
+        void LeaRdi(int32_t offset) { Byte(0x48); Byte(0x8d); Byte(0xbf); Dword(offset); }
+        // mov r8, [base] and mov [base], r8; base is rax, rcx, rdx or rsi
+        void LoadIndirect(int dst, int base) { Rex(false, dst, 0, base); Byte(0x8a); Byte(((dst & 7) << 3) | (base & 7)); }
+        void StoreIndirect(int base, int src) { Rex(false, src, 0, base); Byte(0x88); Byte(((src & 7) << 3) | (base & 7)); }
+        void MovzxIndirect(int dst, int base) { Rex(false, dst, 0, base); Byte(0x0f); Byte(0xb6); Byte(((dst & 7) << 3) | (base & 7)); }
+        // mov r8, [base + index]
+        void LoadIndexed(int dst, int base, int index) { Rex(false, dst, index, base); Byte(0x8a); Byte(0x04 | ((dst & 7) << 3)); Byte(((index & 7) << 3) | (base & 7)); }
+
+        void Push(int reg) { if (reg >= 8) Byte(0x41); Byte(0x50 + (reg & 7)); }
+        void Pop(int reg) { if (reg >= 8) Byte(0x41); Byte(0x58 + (reg & 7)); }
+        void CallRax() { Byte(0xff); Byte(0xd0); }
+        void Ret() { Byte(0xc3); }
+
+        // Jumps return where their displacement goes, for Bind
+        size_t Jcc8(int cc) { Byte(0x70 + cc); Byte(0); return size - 1; }
+        size_t Jmp8() { Byte(0xeb); Byte(0); return size - 1; }
+        size_t Jcc32(int cc) { Byte(0x0f); Byte(0x80 + cc); Dword(0); return size - 4; }
+        size_t Jmp32() { Byte(0xe9); Dword(0); return size - 4; }
+        // Points a jump at the current position
+        void Bind8(size_t at) { if (at < capacity) code[at] = (uint8_t)(size - (at + 1)); }
+        void Bind32(size_t at) { Bind32(at, size); }
+        void Bind32(size_t at, size_t target) {
+            uint32_t displacement = (uint32_t)(target - (at + 4));
+            for (int i = 0; i < 4; i++) if (at + i < capacity) code[at + i] = displacement >> (8 * i);
+        }
+
+    private:
+        uint8_t *code;
+        size_t capacity;
+        size_t size = 0;
+        bool overflow = false;
+};
+
+enum { ALU_ADD = 0, ALU_OR = 1, ALU_ADC = 2, ALU_SBB = 3, ALU_AND = 4, ALU_SUB = 5, ALU_XOR = 6, ALU_CMP = 7 };
+// The 8080 ALU group field (ADD, ADC, SUB, SBB, ANA, XRA, ORA, CMP) in x86 order
+static const int ALU_GROUP[8] = { ALU_ADD, ALU_ADC, ALU_SUB, ALU_SBB, ALU_AND, ALU_XOR, ALU_OR, ALU_CMP };
+
+// Emits one block. Side exits leave before an instruction that needs the
+// interpreter, with pc, cycles and the count as of the start of it.
+class BlockTranslator {
+    public:
+        BlockTranslator(X86Emitter& emit, int32_t readTable, int32_t writeTable, int32_t emulatorOffset)
+            : emit(emit), readTable(readTable), writeTable(writeTable), emulatorOffset(emulatorOffset) {}
+
+        static const uint8_t A = offsetof(Emulator8080::State8080, a), SP = offsetof(Emulator8080::State8080, sp), PC = offsetof(Emulator8080::State8080, pc);
+        static const uint8_t FLAGS = offsetof(Emulator8080::State8080, flags), ZSP = offsetof(Emulator8080::State8080, zsp);
+        static const uint8_t LAZY = offsetof(Emulator8080::State8080, flags_lazy), INT_ENABLE = offsetof(Emulator8080::State8080, int_enable);
+        static const uint8_t HALTED = offsetof(Emulator8080::State8080, halted);
+        static const uint8_t CYCLES = offsetof(Emulator8080::State8080, cycles), INSTRUCTIONS = offsetof(Emulator8080::State8080, instructions);
+
+        // Where the instruction being translated starts
+        void Begin(uint16_t pc, uint32_t cycles, uint32_t count) { instructionPc = pc; cyclesBefore = cycles; countBefore = count; }
+
+        void Prologue() {
+            emit.Push(12); emit.Push(13); emit.Push(14);
+            LoadRegisters();
+        }
+
+        // Leaves with pc set to a constant, or already stored when dynamic
+        void ExitTo(uint16_t pc, uint32_t cycles, uint32_t count) {
+            emit.MovMemImm16(PC, pc);
+            ExitDynamic(cycles, count);
+        }
+        void ExitDynamic(uint32_t cycles, uint32_t count) {
+            if (cycles != 0) emit.AddMem64Imm(CYCLES, cycles);
+            if (count != 0) emit.AddMem64Imm(INSTRUCTIONS, count);
+            epilogueJumps.push_back(emit.Jmp32());
+        }
+
+        // Side exit stubs, then the shared epilogue
+        void Finish() {
+            for (const SideExit& exit : sideExits) {
+                for (size_t at : exit.jumps) emit.Bind32(at);
+                ExitTo(exit.pc, exit.cycles, exit.count);
+            }
+            for (size_t at : epilogueJumps) emit.Bind32(at);
+            StoreRegisters();
+            emit.Pop(14); emit.Pop(13); emit.Pop(12);
+            emit.Ret();
+        }
+
+        // H:L, B:C or D:E as a 16 bit address in dst
+        void PairAddress(int dst, int high, int low) {
+            emit.MovzxReg8(dst, high);
+            emit.ShiftReg32(4, dst, 8);
+            emit.AluRegReg(0x08, dst, low);
+        }
+        void StackAddress(int dst, int delta) {
+            emit.MovzxMem16(dst, SP);
+            if (delta != 0) {
+                emit.AluReg32Imm(ALU_ADD, dst, (uint32_t)delta);
+                emit.MovzxReg16(dst, dst);
+            }
+        }
+
+        // Turns the address in address (rcx or rdx) into a pointer to its
+        // byte in out (rax or rsi) through a page table, leaving by a side
+        // exit where the table has no page. address keeps only its low byte.
+        void Resolve(int32_t table, int address, int out) {
+            emit.AluReg32(0x89, out, address);
+            emit.ShiftReg32(5, out, 8);
+            emit.LoadTableEntry(out, out, table);
+            emit.TestReg64(out);
+            SideExitIf(CC_Z);
+            emit.MovzxReg8(address, address);
+            emit.AddReg64(out, address);
+        }
+        // The address in rcx into rax and the one delta away into rsi
+        void ResolveTwo(int32_t table, int delta) {
+            emit.AluReg32(0x89, RDX, RCX);
+            emit.AluReg32Imm(ALU_ADD, RDX, (uint32_t)delta);
+            emit.MovzxReg16(RDX, RDX);
+            Resolve(table, RCX, RAX);
+            Resolve(table, RDX, RSI);
+        }
+        void Read(int dst) { Resolve(readTable, RCX, RAX); emit.LoadIndirect(dst, RAX); }
+        void Write(int src) { Resolve(writeTable, RCX, RAX); emit.StoreIndirect(RAX, src); }
+        int32_t ReadTable() const { return readTable; }
+        int32_t WriteTable() const { return writeTable; }
+
+        // ALU operation on A with the operand in dl
+        void Alu(int kind) {
+            switch (kind) {
+                case ALU_ADD:
+                case ALU_ADC:
+                    emit.MovRegReg(RCX, HOST_A);
+                    if (kind == ALU_ADC) CarryIntoCf();
+                    emit.AluRegReg(kind == ALU_ADC ? 0x10 : 0x00, HOST_A, RDX);
+                    emit.Setcc(CC_C, RAX);
+                    ArithmeticFlags(HOST_A, false);
+                    break;
+                case ALU_SUB:
+                case ALU_SBB:
+                case ALU_CMP: {
+                    // CMP subtracts into sil and leaves A alone
+                    int result = kind == ALU_CMP ? RSI : HOST_A;
+                    emit.MovRegReg(RCX, HOST_A);
+                    if (kind == ALU_CMP) emit.MovRegReg(RSI, HOST_A);
+                    if (kind == ALU_SBB) CarryIntoCf();
+                    emit.AluRegReg(kind == ALU_SBB ? 0x18 : 0x28, result, RDX);
+                    emit.Setcc(CC_C, RAX);
+                    ArithmeticFlags(result, true);
+                    break;
+                }
+                case ALU_AND:
+                    // AC is the OR of bit 3 of the operands
+                    emit.MovRegReg(RCX, HOST_A);
+                    emit.AluRegReg(0x08, RCX, RDX);
+                    emit.AluRegImm(ALU_AND, RCX, 0x08);
+                    emit.ShiftReg(4, RCX);
+                    emit.AluRegReg(0x20, HOST_A, RDX);
+                    emit.AluMemImm(ALU_AND, FLAGS, (uint8_t)~(FLAG_CY | FLAG_AC));
+                    emit.AluMemReg(0x08, FLAGS, RCX);
+                    SetResult(HOST_A);
+                    break;
+                case ALU_XOR:
+                case ALU_OR:
+                    emit.AluRegReg(kind == ALU_XOR ? 0x30 : 0x08, HOST_A, RDX);
+                    emit.AluMemImm(ALU_AND, FLAGS, (uint8_t)~(FLAG_CY | FLAG_AC));
+                    SetResult(HOST_A);
+                    break;
+            }
+        }
+
+        // INR or DCR of reg, already done; AC is set on a carry out of the
+        // low nibble (INR) or unless it borrowed (DCR)
+        void IncrementFlags(int reg, bool decrement) {
+            emit.MovRegReg(RAX, reg);
+            emit.AluRegImm(ALU_AND, RAX, 0x0f);
+            if (decrement) {
+                emit.AluRegImm(ALU_CMP, RAX, 0x0f);
+                emit.Setcc(CC_NZ, RAX);
+            } else {
+                emit.Setcc(CC_Z, RAX);
+            }
+            emit.ShiftRegImm(4, RAX, 4);
+            emit.AluMemImm(ALU_AND, FLAGS, (uint8_t)~FLAG_AC);
+            emit.AluMemReg(0x08, FLAGS, RAX);
+            SetResult(reg);
+        }
+
+        // CY from x86 CF, after a rotate or DAD
+        void CarryFromCf() {
+            emit.Setcc(CC_C, RAX);
+            emit.AluMemImm(ALU_AND, FLAGS, (uint8_t)~FLAG_CY);
+            emit.AluMemReg(0x08, FLAGS, RAX);
+        }
+        void CarryIntoCf() {
+            emit.LoadReg(RAX, FLAGS);
+            emit.ShiftReg(5, RAX);
+        }
+
+        // al = 1 when the condition field of a Jcc, Ccc or Rcc holds. Z, S
+        // and P come from zsp while the flags are lazy, as in Zero, Sign and
+        // ParityEven
+        void Condition(int condition) {
+            static const int SETCC[4] = { CC_Z, CC_C, CC_P, CC_S };
+            static const uint8_t MASK[4] = { FLAG_Z, FLAG_CY, FLAG_P, FLAG_S };
+            int flag = condition >> 1;
+            if (flag == 1) {
+                emit.LoadReg(RAX, FLAGS);
+                emit.AluRegImm(ALU_AND, RAX, FLAG_CY);
+            } else {
+                emit.AluMemImm(ALU_CMP, LAZY, 0);
+                size_t packed = emit.Jcc8(CC_Z);
+                emit.LoadReg(RAX, ZSP);
+                emit.AluRegReg(0x84, RAX, RAX);
+                emit.Setcc(SETCC[flag], RAX);
+                size_t done = emit.Jmp8();
+                emit.Bind8(packed);
+                emit.LoadReg(RAX, FLAGS);
+                emit.TestRegImm(RAX, MASK[flag]);
+                emit.Setcc(CC_NZ, RAX);
+                emit.Bind8(done);
+            }
+            if ((condition & 1) == 0) emit.AluRegImm(ALU_XOR, RAX, 1);
+        }
+
+        // Folds lazy S, Z and P into the packed flags, as Flags does
+        void FoldFlags() {
+            emit.AluMemImm(ALU_CMP, LAZY, 0);
+            size_t packed = emit.Jcc8(CC_Z);
+            emit.LoadReg(RCX, ZSP);
+            emit.MovzxReg8(RCX, RCX);
+            emit.MovReg64Imm(RDX, (uint64_t)ZSP_TABLE.value);
+            emit.LoadIndexed(RCX, RDX, RCX);
+            emit.AluMemImm(ALU_AND, FLAGS, (uint8_t)~FLAGS_ZSP);
+            emit.AluMemReg(0x08, FLAGS, RCX);
+            emit.MovMemImm8(LAZY, 0);
+            emit.Bind8(packed);
+        }
+
+        // Pushes high then low below sp, leaving before the instruction if
+        // either store needs the slow path
+        void PushBytes(int high, int low) {
+            StackAddress(RCX, -1);
+            ResolveTwo(writeTable, -1);
+            emit.StoreIndirect(RAX, high);
+            emit.StoreIndirect(RSI, low);
+            emit.AluMem16Imm(ALU_SUB, SP, 2);
+        }
+        void PushWord(uint16_t value) {
+            StackAddress(RCX, -1);
+            ResolveTwo(writeTable, -1);
+            emit.MovRegImm(RDX, value >> 8);
+            emit.StoreIndirect(RAX, RDX);
+            emit.MovRegImm(RDX, value & 0xff);
+            emit.StoreIndirect(RSI, RDX);
+            emit.AluMem16Imm(ALU_SUB, SP, 2);
+        }
+        // Pops the return address into pc
+        void PopPc() {
+            StackAddress(RCX, 0);
+            ResolveTwo(readTable, 1);
+            emit.MovzxIndirect(RCX, RAX);
+            emit.MovzxIndirect(RDX, RSI);
+            emit.ShiftReg32(4, RDX, 8);
+            emit.AluReg32(0x09, RCX, RDX);
+            emit.StoreReg16(PC, RCX);
+            emit.AluMem16Imm(ALU_ADD, SP, 2);
+        }
+
+        // Runs the interpreter's handler for the instruction in place, for
+        // DAA; the pinned registers go through the state around the call
+        void CallHandler(uint64_t handler) {
+            StoreRegisters();
+            // rdi twice keeps the stack 16 byte aligned for the call
+            emit.Push(RDI); emit.Push(RDI);
+            emit.MovReg64(RSI, RDI);
+            emit.LeaRdi(emulatorOffset);
+            emit.MovReg32Imm(RDX, 0);
+            emit.MovReg64Imm(RAX, handler);
+            emit.CallRax();
+            emit.Pop(RDI); emit.Pop(RDI);
+            LoadRegisters();
+        }
+
+    private:
+        struct SideExit {
+            uint16_t pc;
+            uint32_t cycles;
+            uint32_t count;
+            std::vector<size_t> jumps;
+        };
+
+        X86Emitter& emit;
+        int32_t readTable, writeTable, emulatorOffset;
+        uint16_t instructionPc = 0;
+        uint32_t cyclesBefore = 0, countBefore = 0;
+        std::vector<SideExit> sideExits;
+        std::vector<size_t> epilogueJumps;
+
+        void SideExitIf(int cc) {
+            if (sideExits.empty() || sideExits.back().count != countBefore) sideExits.push_back({instructionPc, cyclesBefore, countBefore, {}});
+            sideExits.back().jumps.push_back(emit.Jcc32(cc));
+        }
+
+        void LoadRegisters() {
+            for (int r = 0; r < 8; r++) if (r != 6) emit.LoadReg(HOST_REGISTER[r], RegisterOffset(r));
+        }
+        void StoreRegisters() {
+            for (int r = 0; r < 8; r++) if (r != 6) emit.StoreReg(RegisterOffset(r), HOST_REGISTER[r]);
+        }
+        static uint8_t RegisterOffset(int r) {
+            static const uint8_t OFFSETS[8] = {
+                (uint8_t)offsetof(Emulator8080::State8080, b), (uint8_t)offsetof(Emulator8080::State8080, c), (uint8_t)offsetof(Emulator8080::State8080, d),
+                (uint8_t)offsetof(Emulator8080::State8080, e), (uint8_t)offsetof(Emulator8080::State8080, h), (uint8_t)offsetof(Emulator8080::State8080, l), 0,
+                (uint8_t)offsetof(Emulator8080::State8080, a)
+            };
+            return OFFSETS[r];
+        }
+
+        // CY is in al; AC is bit 4 of a ^ operand ^ result (inverted for a
+        // subtraction, which the 8080 does by adding the complement)
+        void ArithmeticFlags(int result, bool subtract) {
+            emit.AluRegReg(0x30, RCX, RDX);
+            emit.AluRegReg(0x30, RCX, result);
+            if (subtract) emit.NotReg(RCX);
+            emit.AluRegImm(ALU_AND, RCX, 0x10);
+            emit.AluRegReg(0x08, RAX, RCX);
+            emit.AluMemImm(ALU_AND, FLAGS, (uint8_t)~(FLAG_CY | FLAG_AC));
+            emit.AluMemReg(0x08, FLAGS, RAX);
+            SetResult(result);
+        }
+        void SetResult(int reg) {
+            emit.StoreReg(ZSP, reg);
+            emit.MovMemImm8(LAZY, 1);
+        }
+};
+
+bool Emulator8080::JitAvailable() {
+    return true;
+}
+
+void Emulator8080::ReleaseJitCode() {
+    if (jitCode != nullptr) munmap(jitCode, JIT_CODE_SIZE);
+    jitCode = nullptr;
+    jitCodeUsed = 0;
+}
+
+bool Emulator8080::TranslateBlock(Block* block) {
+    static_assert(offsetof(State8080, instructions) < 0x80, "State8080 fields must be reachable with 8 bit displacements");
+    const uint8_t SP = BlockTranslator::SP, INT_ENABLE = BlockTranslator::INT_ENABLE, HALTED = BlockTranslator::HALTED;
+    const uint8_t FLAGS = BlockTranslator::FLAGS, LAZY = BlockTranslator::LAZY;
+    // The page tables and the emulator, relative to the state native code gets
+    const uint8_t *state = (const uint8_t *)&processor;
+    int32_t readTable = (int32_t)((const uint8_t *)readPages - state);
+    int32_t writeTable = (int32_t)((const uint8_t *)writePages - state);
+    int32_t emulatorOffset = (int32_t)((const uint8_t *)this - state);
+
+    if (jitCode == nullptr) {
+        void *region = mmap(nullptr, JIT_CODE_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED) return false;
+        jitCode = (uint8_t *)region;
+    }
+    // Only the pages a block can be emitted into are writable, and only
+    // while it is emitted
+    auto protect = [this](size_t start, size_t end, int access) {
+        if (mprotect(jitCode + start, end - start, access) == 0) return;
+        printf("error: Couldn't change the protection of JIT code\n");
+        exit(1);
+    };
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t windowStart = jitCodeUsed & ~(HOST_PAGE_SIZE - 1);
+        size_t windowEnd = windowStart + JIT_BLOCK_CODE_SIZE;
+        if (windowEnd > JIT_CODE_SIZE) windowEnd = JIT_CODE_SIZE;
+        protect(windowStart, windowEnd, PROT_READ | PROT_WRITE);
+        X86Emitter emit(jitCode + jitCodeUsed, windowEnd - jitCodeUsed);
+        BlockTranslator native(emit, readTable, writeTable, emulatorOffset);
+        native.Prologue();
+
+        uint16_t pc = block->start;
+        uint32_t cycles = 0;
+        int count = 0;
+        bool ended = false;
+        for (const MicroOp& op : block->ops) {
+            uint8_t opcode = op.bytes[0];
+            uint16_t immediate = op.bytes[1] | (op.bytes[2] << 8);
+            uint16_t next = pc + op.length;
+            int dst = (opcode >> 3) & 7, src = opcode & 7, pair = (opcode >> 4) & 3;
+            // Cycles and count once this instruction has run
+            uint32_t total = cycles + op.cycles;
+            int after = count + 1;
+            if (opcode == 0xd3 || opcode == 0xdb) break;                                        //OUT, IN
+            native.Begin(pc, cycles, count);
+
+            if (opcode == 0x00 || ((opcode & 0xc7) == 0x00 && opcode <= 0x38)) {
+                // NOP and its undocumented aliases
+            } else if (opcode == 0x76) {                                                        //HLT
+                emit.MovMemImm8(HALTED, 1);
+                native.ExitTo(next, total, after);
+                ended = true;
+            } else if (opcode >= 0x40 && opcode <= 0x7f) {
+                if (src == 6) {                                                                 //MOV r,M
+                    native.PairAddress(RCX, HOST_H, HOST_L);
+                    native.Read(HOST_REGISTER[dst]);
+                } else if (dst == 6) {                                                          //MOV M,r
+                    native.PairAddress(RCX, HOST_H, HOST_L);
+                    native.Write(HOST_REGISTER[src]);
+                } else if (dst != src) {                                                        //MOV r,r
+                    emit.MovRegReg(HOST_REGISTER[dst], HOST_REGISTER[src]);
+                }
+            } else if ((opcode & 0xc7) == 0x06) {                                               //MVI
+                if (dst == 6) {
+                    native.PairAddress(RCX, HOST_H, HOST_L);
+                    emit.MovRegImm(RDX, op.bytes[1]);
+                    native.Write(RDX);
+                } else {
+                    emit.MovRegImm(HOST_REGISTER[dst], op.bytes[1]);
+                }
+            } else if ((opcode & 0xc6) == 0x04) {                                               //INR, DCR
+                bool decrement = opcode & 1;
+                if (dst == 6) {
+                    native.PairAddress(RCX, HOST_H, HOST_L);
+                    native.Resolve(native.WriteTable(), RCX, RAX);
+                    emit.LoadIndirect(RDX, RAX);
+                    emit.IncDecReg(decrement, RDX);
+                    emit.StoreIndirect(RAX, RDX);
+                    native.IncrementFlags(RDX, decrement);
+                } else {
+                    emit.IncDecReg(decrement, HOST_REGISTER[dst]);
+                    native.IncrementFlags(HOST_REGISTER[dst], decrement);
+                }
+            } else if (opcode >= 0x80 && opcode <= 0xbf) {                                      //ALU r, ALU M
+                if (src == 6) {
+                    native.PairAddress(RCX, HOST_H, HOST_L);
+                    native.Read(RDX);
+                } else {
+                    emit.MovRegReg(RDX, HOST_REGISTER[src]);
+                }
+                native.Alu(ALU_GROUP[dst]);
+            } else if ((opcode & 0xc7) == 0xc6) {                                               //ALU immediate
+                emit.MovRegImm(RDX, op.bytes[1]);
+                native.Alu(ALU_GROUP[dst]);
+            } else if ((opcode & 0xcf) == 0x01) {                                               //LXI
+                if (pair == 3) emit.MovMemImm16(SP, immediate);
+                else { emit.MovRegImm(PAIR_LOW[pair], op.bytes[1]); emit.MovRegImm(PAIR_HIGH[pair], op.bytes[2]); }
+            } else if ((opcode & 0xcf) == 0x03) {                                               //INX
+                if (pair == 3) emit.AluMem16Imm(ALU_ADD, SP, 1);
+                else { emit.AluRegImm(ALU_ADD, PAIR_LOW[pair], 1); emit.AluRegImm(ALU_ADC, PAIR_HIGH[pair], 0); }
+            } else if ((opcode & 0xcf) == 0x0b) {                                               //DCX
+                if (pair == 3) emit.AluMem16Imm(ALU_SUB, SP, 1);
+                else { emit.AluRegImm(ALU_SUB, PAIR_LOW[pair], 1); emit.AluRegImm(ALU_SBB, PAIR_HIGH[pair], 0); }
+            } else if ((opcode & 0xcf) == 0x09) {                                               //DAD
+                if (pair == 3) {
+                    emit.MovzxMem16(RAX, SP);
+                    emit.AluReg32(0x89, RCX, RAX);
+                    emit.ShiftReg32(5, RCX, 8);
+                    emit.AluRegReg(0x00, HOST_L, RAX);
+                    emit.AluRegReg(0x10, HOST_H, RCX);
+                } else {
+                    emit.AluRegReg(0x00, HOST_L, PAIR_LOW[pair]);
+                    emit.AluRegReg(0x10, HOST_H, PAIR_HIGH[pair]);
+                }
+                native.CarryFromCf();
+            } else if (opcode == 0x02 || opcode == 0x12) {                                      //STAX
+                native.PairAddress(RCX, PAIR_HIGH[pair], PAIR_LOW[pair]);
+                native.Write(HOST_A);
+            } else if (opcode == 0x0a || opcode == 0x1a) {                                      //LDAX
+                native.PairAddress(RCX, PAIR_HIGH[pair], PAIR_LOW[pair]);
+                native.Read(HOST_A);
+            } else if (opcode == 0x32) {                                                        //STA
+                emit.MovReg32Imm(RCX, immediate);
+                native.Write(HOST_A);
+            } else if (opcode == 0x3a) {                                                        //LDA
+                emit.MovReg32Imm(RCX, immediate);
+                native.Read(HOST_A);
+            } else if (opcode == 0x22 || opcode == 0x2a) {                                      //SHLD, LHLD
+                emit.MovReg32Imm(RCX, immediate);
+                native.ResolveTwo(opcode == 0x22 ? native.WriteTable() : native.ReadTable(), 1);
+                if (opcode == 0x22) { emit.StoreIndirect(RAX, HOST_L); emit.StoreIndirect(RSI, HOST_H); }
+                else { emit.LoadIndirect(HOST_L, RAX); emit.LoadIndirect(HOST_H, RSI); }
+            } else if (opcode == 0x07 || opcode == 0x0f || opcode == 0x17 || opcode == 0x1f) {  //RLC, RRC, RAL, RAR
+                if (opcode == 0x17 || opcode == 0x1f) native.CarryIntoCf();
+                emit.ShiftReg(dst, HOST_A);
+                native.CarryFromCf();
+            } else if (opcode == 0x27) {                                                        //DAA
+                native.CallHandler((uint64_t)opcodeHandlers[0x27]);
+            } else if (opcode == 0x2f) {                                                        //CMA
+                emit.NotReg(HOST_A);
+            } else if (opcode == 0x37) {                                                        //STC
+                emit.AluMemImm(ALU_OR, FLAGS, FLAG_CY);
+            } else if (opcode == 0x3f) {                                                        //CMC
+                emit.AluMemImm(ALU_XOR, FLAGS, FLAG_CY);
+            } else if (opcode == 0xeb) {                                                        //XCHG
+                emit.AluRegReg(0x86, 11, 13);
+                emit.AluRegReg(0x86, 12, 14);
+            } else if (opcode == 0xe3) {                                                        //XTHL
+                native.StackAddress(RCX, 0);
+                native.ResolveTwo(native.WriteTable(), 1);
+                emit.LoadIndirect(RDX, RAX);
+                emit.StoreIndirect(RAX, HOST_L);
+                emit.MovRegReg(HOST_L, RDX);
+                emit.LoadIndirect(RDX, RSI);
+                emit.StoreIndirect(RSI, HOST_H);
+                emit.MovRegReg(HOST_H, RDX);
+            } else if (opcode == 0xf9) {                                                        //SPHL
+                native.PairAddress(RCX, HOST_H, HOST_L);
+                emit.StoreReg16(SP, RCX);
+            } else if (opcode == 0xf3 || opcode == 0xfb) {                                      //DI, EI
+                emit.MovMemImm8(INT_ENABLE, opcode == 0xfb);
+            } else if ((opcode & 0xcf) == 0xc5) {                                               //PUSH
+                if (pair == 3) {
+                    native.StackAddress(RCX, -1);
+                    native.ResolveTwo(native.WriteTable(), -1);
+                    native.FoldFlags();
+                    emit.LoadReg(RDX, FLAGS);
+                    emit.StoreIndirect(RAX, HOST_A);
+                    emit.StoreIndirect(RSI, RDX);
+                    emit.AluMem16Imm(ALU_SUB, SP, 2);
+                } else {
+                    native.PushBytes(PAIR_HIGH[pair], PAIR_LOW[pair]);
+                }
+            } else if ((opcode & 0xcf) == 0xc1) {                                               //POP
+                native.StackAddress(RCX, 0);
+                native.ResolveTwo(native.ReadTable(), 1);
+                if (pair == 3) {
+                    emit.LoadIndirect(RDX, RAX);
+                    emit.LoadIndirect(HOST_A, RSI);
+                    emit.AluRegImm(ALU_AND, RDX, FLAGS_ZSP | FLAG_AC | FLAG_CY);
+                    emit.AluRegImm(ALU_OR, RDX, FLAG_ALWAYS_ONE);
+                    emit.StoreReg(FLAGS, RDX);
+                    emit.MovMemImm8(LAZY, 0);
+                } else {
+                    emit.LoadIndirect(PAIR_LOW[pair], RAX);
+                    emit.LoadIndirect(PAIR_HIGH[pair], RSI);
+                }
+                emit.AluMem16Imm(ALU_ADD, SP, 2);
+            } else if (opcode == 0xc3 || opcode == 0xcb) {                                      //JMP
+                native.ExitTo(immediate, total, after);
+                ended = true;
+            } else if ((opcode & 0xc7) == 0xc2) {                                               //Jcc
+                native.Condition(dst);
+                emit.AluRegReg(0x84, RAX, RAX);
+                size_t taken = emit.Jcc32(CC_NZ);
+                native.ExitTo(next, total, after);
+                emit.Bind32(taken);
+                native.ExitTo(immediate, total, after);
+                ended = true;
+            } else if (opcode == 0xcd || opcode == 0xdd || opcode == 0xed || opcode == 0xfd) {  //CALL
+                native.PushWord(next);
+                native.ExitTo(immediate, total, after);
+                ended = true;
+            } else if ((opcode & 0xc7) == 0xc4) {                                               //Ccc
+                native.Condition(dst);
+                emit.AluRegReg(0x84, RAX, RAX);
+                size_t skipped = emit.Jcc32(CC_Z);
+                native.PushWord(next);
+                native.ExitTo(immediate, total + 6, after);
+                emit.Bind32(skipped);
+                native.ExitTo(next, total, after);
+                ended = true;
+            } else if (opcode == 0xc9 || opcode == 0xd9) {                                      //RET
+                native.PopPc();
+                native.ExitDynamic(total, after);
+                ended = true;
+            } else if ((opcode & 0xc7) == 0xc0) {                                               //Rcc
+                native.Condition(dst);
+                emit.AluRegReg(0x84, RAX, RAX);
+                size_t skipped = emit.Jcc32(CC_Z);
+                native.PopPc();
+                native.ExitDynamic(total + 6, after);
+                emit.Bind32(skipped);
+                native.ExitTo(next, total, after);
+                ended = true;
+            } else if ((opcode & 0xc7) == 0xc7) {                                               //RST
+                native.PushWord(next);
+                native.ExitTo(opcode & 0x38, total, after);
+                ended = true;
+            } else if (opcode == 0xe9) {                                                        //PCHL
+                native.PairAddress(RCX, HOST_H, HOST_L);
+                emit.StoreReg16(BlockTranslator::PC, RCX);
+                native.ExitDynamic(total, after);
+                ended = true;
+            }
+
+            cycles = total;
+            count = after;
+            pc = next;
+            if (ended) break;
+        }
+
+        if (count > 0) {
+            if (!ended) native.ExitTo(pc, cycles, count);
+            native.Finish();
+        }
+        protect(windowStart, windowEnd, PROT_READ | PROT_EXEC);
+        if (count == 0) return false;
+
+        if (!emit.Overflowed()) {
+            block->native = (NativeCode)(jitCode + jitCodeUsed);
+            block->nativeInstructions = count;
+            jitCodeUsed += emit.Size();
+            return true;
+        }
+        // Out of code space: drop every translation and start over
+        for (std::unique_ptr<Block>& cached : blocks) {
+            if (cached) cached->native = nullptr;
+        }
+        jitCodeUsed = 0;
+    }
+    return false;
+}
+
+void Emulator8080::RunNativeVerified(Block* block) {
+    // Native code stores to memory, so the interpreter replays the same run
+    // from a copy of the state and memory taken before it
+    State8080 before = processor;
+    std::vector<uint8_t> memory(processor.memory, processor.memory + RomSet::MEMORY_SIZE);
+    block->native(&processor);
+    State8080 native = processor;
+    std::vector<uint8_t> nativeMemory(processor.memory, processor.memory + RomSet::MEMORY_SIZE);
+
+    memcpy(processor.memory, memory.data(), RomSet::MEMORY_SIZE);
+    processor = before;
+    uint64_t ran = native.instructions - before.instructions;
+    for (uint64_t i = 0; i < ran && i < block->ops.size(); i++) {
+        const MicroOp& op = block->ops[i];
+        processor.cycles += op.cycles;
+        processor.instructions++;
+        op.handler(this, &processor, op.bytes);
+    }
+    State8080& reference = processor;
+
+    uint8_t nativeFlags = Flags(&native);
+    uint8_t referenceFlags = Flags(&reference);
+    int stored = -1;
+    for (uint32_t address = 0; address < RomSet::MEMORY_SIZE && stored < 0; address++) {
+        if (processor.memory[address] != nativeMemory[address]) stored = address;
+    }
+    if (native.a != reference.a || native.b != reference.b || native.c != reference.c ||
+        native.d != reference.d || native.e != reference.e || native.h != reference.h ||
+        native.l != reference.l || native.sp != reference.sp || native.pc != reference.pc ||
+        native.cycles != reference.cycles || native.instructions != reference.instructions ||
+        nativeFlags != referenceFlags || native.halted != reference.halted ||
+        native.int_enable != reference.int_enable || stored >= 0) {
+        jitMismatches++;
+        printf("jit: block %04x (%d instructions) diverges from the interpreter:\n", block->start, block->nativeInstructions);
+        printf("jit:   native      A=%02x BC=%02x%02x DE=%02x%02x HL=%02x%02x SP=%04x PC=%04x F=%02x cycles=%llu\n",
+                native.a, native.b, native.c, native.d, native.e, native.h, native.l, native.sp, native.pc, nativeFlags,
+                (unsigned long long)native.cycles);
+        printf("jit:   interpreter A=%02x BC=%02x%02x DE=%02x%02x HL=%02x%02x SP=%04x PC=%04x F=%02x cycles=%llu\n",
+                reference.a, reference.b, reference.c, reference.d, reference.e, reference.h, reference.l, reference.sp, reference.pc,
+                referenceFlags, (unsigned long long)reference.cycles);
+        if (stored >= 0) {
+            printf("jit:   memory at %04x: native %02x, interpreter %02x\n", stored, nativeMemory[stored], processor.memory[stored]);
+        }
+        // The interpreter is the reference: keep its result and stop
+        // translating this block
+        block->native = nullptr;
+    }
+}
+
+#else
+
+bool Emulator8080::JitAvailable() {
+    return false;
+}
+
+void Emulator8080::ReleaseJitCode() {
+}
+
+bool Emulator8080::TranslateBlock(Block* block) {
+    return false;
+}
+
+void Emulator8080::RunNativeVerified(Block* block) {
+}
+
+#endif
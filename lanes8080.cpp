@@ -0,0 +1,658 @@
+#include "lanes8080.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+template<int Lanes>
+LaneGroup<Lanes>::LaneGroup(const std::vector<Emulator8080*>& emulators) {
+    if (emulators.size() > Lanes) {
+        printf("error: a lane group holds at most %d instances\n", Lanes);
+        exit(1);
+    }
+    count = (int)emulators.size();
+    std::copy(emulators.begin(), emulators.end(), instances);
+    // Idle lanes compute along with the rest and are masked off
+    for (int lane = 0; lane < Lanes; lane++) {
+        a[lane] = b[lane] = c[lane] = d[lane] = e[lane] = h[lane] = l[lane] = 0;
+        flags[lane] = zsp[lane] = lazy[lane] = 0;
+        sp[lane] = pc[lane] = 0;
+        left[lane] = loaded[lane] = 0;
+        retired[lane] = 0;
+    }
+    memset(modified, 0, sizeof(modified));
+    memset(modifiedSeen, 0, sizeof(modifiedSeen));
+}
+
+template<int Lanes>
+void LaneGroup<Lanes>::Load(int lane) {
+    const State8080& state = instances[lane]->processor;
+    a[lane] = state.a; b[lane] = state.b; c[lane] = state.c; d[lane] = state.d;
+    e[lane] = state.e; h[lane] = state.h; l[lane] = state.l;
+    flags[lane] = state.flags; zsp[lane] = state.zsp; lazy[lane] = state.flags_lazy;
+    sp[lane] = state.sp; pc[lane] = state.pc;
+    uint64_t remaining = until[lane] > state.cycles ? until[lane] - state.cycles : 0;
+    left[lane] = loaded[lane] = (int32_t)std::min<uint64_t>(remaining, INT32_MAX);
+    retired[lane] = 0;
+    SyncModified(lane);
+}
+
+template<int Lanes>
+void LaneGroup<Lanes>::Store(int lane) {
+    State8080& state = instances[lane]->processor;
+    state.a = a[lane]; state.b = b[lane]; state.c = c[lane]; state.d = d[lane];
+    state.e = e[lane]; state.h = h[lane]; state.l = l[lane];
+    state.flags = flags[lane]; state.zsp = zsp[lane]; state.flags_lazy = lazy[lane];
+    state.sp = sp[lane]; state.pc = pc[lane];
+    state.cycles += loaded[lane] - left[lane];
+    state.instructions += retired[lane];
+    loaded[lane] = left[lane];
+    retired[lane] = 0;
+}
+
+// Bits are only ever added between Resets, so only the new ones are copied
+template<int Lanes>
+void LaneGroup<Lanes>::SyncModified(int lane) {
+    const uint64_t *pages = instances[lane]->modifiedPages;
+    for (int word = 0; word < Emulator8080::PAGES / 64; word++) {
+        uint64_t added = pages[word] & ~modifiedSeen[lane][word];
+        if (!added) continue;
+        modifiedSeen[lane][word] |= added;
+        for (int bit = 0; bit < 64; bit++) {
+            if (added & (1ull << bit)) modified[word * 64 + bit][lane] = 0xff;
+        }
+    }
+}
+
+// The part of RunFor between batches, on a stored lane: dispatches what is
+// due and idles a halted CPU until the lane can run again (true) or its
+// budget is spent
+template<int Lanes>
+bool LaneGroup<Lanes>::Settle(int lane) {
+    Emulator8080& emulator = *instances[lane];
+    State8080& state = emulator.processor;
+    for (;;) {
+        if (state.cycles >= target[lane]) return false;
+        uint64_t next = std::min(target[lane], emulator.events.NextDeadline());
+        if (!state.halted) {
+            if (state.cycles < next) {
+                until[lane] = next;
+                return true;
+            }
+        } else if (state.int_enable) {
+            state.cycles = std::max(state.cycles, next);
+        } else {
+            return false;
+        }
+        emulator.events.Dispatch(state.cycles);
+    }
+}
+
+template<int Lanes>
+void LaneGroup<Lanes>::RunTo(const uint64_t* targets) {
+    // Lanes on the same ROM set and map as the first one start out with the
+    // same memory
+    const Emulator8080& first = *instances[0];
+    for (int lane = 0; lane < count; lane++) {
+        const Emulator8080& emulator = *instances[lane];
+        bool same = emulator.romSet == first.romSet;
+        for (int page = 0; same && page < Emulator8080::PAGES; page++) {
+            if ((emulator.readPages[page] == nullptr) != (first.readPages[page] == nullptr)) same = false;
+            else if (emulator.readPages[page] != nullptr && emulator.MemoryPage(page) != first.MemoryPage(page)) same = false;
+        }
+        sharedMap[lane] = same ? 0xff : 0;
+        // A Reset since the last run may have cleared bits
+        for (int page = 0; page < Emulator8080::PAGES; page++) modified[page][lane] = 0;
+        for (uint64_t& word : modifiedSeen[lane]) word = 0;
+        SyncModified(lane);
+    }
+    for (int lane = 0; lane < count; lane++) {
+        target[lane] = targets[lane];
+        running[lane] = Settle(lane) ? 0xff : 0;
+        if (running[lane]) Load(lane);
+    }
+
+    uint8_t bytes[3];
+    alignas(64) uint8_t on[Lanes];
+    for (;;) {
+        // The lowest pc of the running lanes; stopped lanes count as 0xffff,
+        // which on its own only matters if a lane is running there
+        int active = 0;
+        uint16_t lowest = 0xffff;
+        for (int lane = 0; lane < Lanes; lane++) {
+            active += running[lane] & 1;
+            lowest = std::min<uint16_t>(lowest, pc[lane] | (uint16_t)(int8_t)~running[lane]);
+        }
+        if (active == 0) break;
+        if (active == 1) {
+            // Nothing to run alongside, so the last lane finishes on its
+            // instance's own loop
+            int lane = 0;
+            while (!running[lane]) lane++;
+            Store(lane);
+            State8080& state = instances[lane]->processor;
+            uint64_t before = state.instructions;
+            instances[lane]->RunFor(target[lane] - state.cycles);
+            scalar += state.instructions - before;
+            dispatches += state.instructions - before;
+            running[lane] = 0;
+            break;
+        }
+        for (int lane = 0; lane < Lanes; lane++) on[lane] = running[lane] & (pc[lane] == lowest ? 0xff : 0);
+
+        int members = Select(on, bytes);
+        if (members >= 2 && ExecuteLanes(bytes[0], bytes, on)) {
+            lockstep += members;
+            dispatches++;
+            uint8_t boundary = 0;
+            for (int lane = 0; lane < Lanes; lane++) boundary |= on[lane] & (left[lane] <= 0 ? 0xff : 0);
+            if (!boundary) continue;
+        } else {
+            for (int lane = 0; lane < count; lane++) if (on[lane]) StepScalar(lane);
+            scalar += members;
+            dispatches += members;
+        }
+
+        for (int lane = 0; lane < count; lane++) {
+            if (!on[lane] || (left[lane] > 0 && !instances[lane]->processor.halted)) continue;
+            Store(lane);
+            instances[lane]->events.Dispatch(instances[lane]->processor.cycles);
+            running[lane] = Settle(lane) ? 0xff : 0;
+            if (running[lane]) Load(lane);
+        }
+    }
+}
+
+// Narrows on, the lanes at one pc, to those with the same instruction bytes
+// as the first of them, which go into bytes; returns how many are left.
+// Lanes sharing a map have the same bytes without reading them where the
+// page is ROM, or where none of the two has stored to it since a Reset.
+template<int Lanes>
+int LaneGroup<Lanes>::Select(uint8_t* on, uint8_t* bytes) {
+    int leader = 0;
+    while (!on[leader]) leader++;
+    if (!FetchLane(leader, bytes)) {
+        for (int lane = leader + 1; lane < count; lane++) on[lane] = 0;
+        return 1;
+    }
+    const Emulator8080& emulator = *instances[leader];
+    uint16_t address = pc[leader];
+    int length = OPCODE_LENGTHS[bytes[0]];
+    bool shared = (address & 0xff) + length <= Emulator8080::PAGE_SIZE && sharedMap[leader];
+    uint8_t page = emulator.MemoryPage(address >> 8);
+    bool rom = shared && emulator.pageAccess[page] == Emulator8080::PAGE_ROM;
+    bool pristine = shared && !modified[page][leader];
+
+    int members = 0;
+    if (rom || pristine) {
+        const uint8_t *stored = modified[page];
+        uint8_t checked = rom ? 0 : 0xff;
+        uint8_t differs = 0;
+        for (int lane = 0; lane < Lanes; lane++) differs |= on[lane] & (~sharedMap[lane] | (stored[lane] & checked));
+        if (!differs) {
+            for (int lane = 0; lane < Lanes; lane++) members += on[lane] & 1;
+            return members;
+        }
+    }
+    uint8_t mine[3];
+    for (int lane = leader + 1; lane < count; lane++) {
+        if (!on[lane]) continue;
+        // On the same map the instruction is within one page of the lane's
+        // own memory, so it is compared in place
+        bool same;
+        if (shared && sharedMap[lane]) {
+            const uint8_t *own = instances[lane]->readPages[address >> 8] + (address & 0xff);
+            same = rom || (pristine && !modified[page][lane]) || std::equal(bytes, bytes + length, own);
+        } else {
+            same = FetchLane(lane, mine) && std::equal(bytes, bytes + length, mine);
+        }
+        if (!same) {
+            on[lane] = 0;
+            continue;
+        }
+        members++;
+    }
+    return members + 1;
+}
+
+template<int Lanes>
+void LaneGroup<Lanes>::RunFor(uint64_t budget) {
+    uint64_t targets[Lanes];
+    for (int lane = 0; lane < count; lane++) targets[lane] = instances[lane]->processor.cycles + budget;
+    RunTo(targets);
+}
+
+// The instruction at the lane's pc, false if any byte of it is on a page
+// mapped to a handler
+template<int Lanes>
+bool LaneGroup<Lanes>::FetchLane(int lane, uint8_t* bytes) {
+    const Emulator8080& emulator = *instances[lane];
+    uint16_t address = pc[lane];
+    const uint8_t *page = emulator.readPages[address >> 8];
+    if (page == nullptr) return false;
+    bytes[0] = page[address & 0xff];
+    for (int i = 1; i < 3; i++) {
+        if (i >= OPCODE_LENGTHS[bytes[0]]) {
+            bytes[i] = 0;
+            continue;
+        }
+        page = emulator.readPages[(uint16_t)(address + i) >> 8];
+        if (page == nullptr) return false;
+        bytes[i] = page[(address + i) & 0xff];
+    }
+    return true;
+}
+
+// One instruction of the lane on its instance's threaded core, as RunLoop
+// would run it
+template<int Lanes>
+void LaneGroup<Lanes>::StepScalar(int lane) {
+    Emulator8080& emulator = *instances[lane];
+    State8080 *state = &emulator.processor;
+    Store(lane);
+    uint8_t fetched[3];
+    const uint8_t *opcode = emulator.Fetch(state->pc, fetched);
+    state->cycles += OPCODE_CYCLES[*opcode];
+    state->instructions++;
+    Emulator8080::opcodeHandlers[*opcode](&emulator, state, opcode);
+    Load(lane);
+}
+
+// Registers in opcode order: B C D E H L M A (M has no array)
+template<int Lanes>
+uint8_t* LaneGroup<Lanes>::Register(int index) {
+    uint8_t *registers[8] = { b, c, d, e, h, l, nullptr, a };
+    return registers[index];
+}
+
+template<int Lanes>
+bool LaneGroup<Lanes>::Gather(const uint16_t* address, const uint8_t* on, uint8_t* values) {
+    for (int lane = 0; lane < count; lane++) {
+        if (on[lane] && instances[lane]->readPages[address[lane] >> 8] == nullptr) return false;
+    }
+    for (int lane = 0; lane < Lanes; lane++) {
+        values[lane] = on[lane] ? instances[lane]->readPages[address[lane] >> 8][address[lane] & 0xff] : 0;
+    }
+    return true;
+}
+
+// Stores to handler pages go through the scalar core, where the handler
+// sees the instance's registers as they are
+template<int Lanes>
+bool LaneGroup<Lanes>::Writable(const uint16_t* address, const uint8_t* on) {
+    for (int lane = 0; lane < count; lane++) {
+        if (on[lane] && instances[lane]->pageHandlers[address[lane] >> 8] != nullptr) return false;
+    }
+    return true;
+}
+
+template<int Lanes>
+void LaneGroup<Lanes>::Scatter(const uint16_t* address, const uint8_t* on, const uint8_t* values) {
+    for (int lane = 0; lane < count; lane++) {
+        // The slow path only uses the instance's memory, not its registers,
+        // and is the only one that marks pages modified
+        if (!on[lane]) continue;
+        Emulator8080& emulator = *instances[lane];
+        bool slow = emulator.writePages[address[lane] >> 8] == nullptr;
+        emulator.WriteMemory(&emulator.processor, address[lane], values[lane]);
+        if (slow) SyncModified(lane);
+    }
+}
+
+template<int Lanes>
+bool LaneGroup<Lanes>::Source(int index, const uint8_t* on, uint8_t* __restrict values) {
+    if (index == 6) {
+        uint16_t address[Lanes];
+        for (int lane = 0; lane < Lanes; lane++) address[lane] = (h[lane] << 8) | l[lane];
+        return Gather(address, on, values);
+    }
+    const uint8_t *source = Register(index);
+    for (int lane = 0; lane < Lanes; lane++) values[lane] = source[lane];
+    return true;
+}
+
+// Whether each lane in on meets condition: NZ Z NC C PO PE P M, by the
+// opcode's bits 3-5. PO and PE fold the lazy flags as ParityEven does.
+template<int Lanes>
+void LaneGroup<Lanes>::Conditions(int condition, const uint8_t* __restrict on, uint8_t* __restrict taken) {
+    for (int lane = 0; lane < Lanes; lane++) {
+        if (condition == 4 || condition == 5) {
+            uint8_t folded = (flags[lane] & ~FLAGS_ZSP) | ZSP_TABLE.value[zsp[lane]];
+            flags[lane] = on[lane] && lazy[lane] ? folded : flags[lane];
+            lazy[lane] = on[lane] ? 0 : lazy[lane];
+        }
+        bool set;
+        if (condition <= 1) set = lazy[lane] ? zsp[lane] == 0 : (flags[lane] & FLAG_Z) != 0;
+        else if (condition <= 3) set = (flags[lane] & FLAG_CY) != 0;
+        else if (condition <= 5) set = (flags[lane] & FLAG_P) != 0;
+        else set = lazy[lane] ? (zsp[lane] & 0x80) != 0 : (flags[lane] & FLAG_S) != 0;
+        taken[lane] = on[lane] && set == (condition & 1) ? 0xff : 0;
+    }
+}
+
+// Stores high and low below the stack pointer of each lane in on, as a
+// push does
+template<int Lanes>
+bool LaneGroup<Lanes>::Push(const uint8_t* on, const uint8_t* high, const uint8_t* low) {
+    uint16_t upper[Lanes], lower[Lanes];
+    for (int lane = 0; lane < Lanes; lane++) {
+        upper[lane] = sp[lane] - 1;
+        lower[lane] = sp[lane] - 2;
+    }
+    if (!Writable(upper, on) || !Writable(lower, on)) return false;
+    Scatter(upper, on, high);
+    Scatter(lower, on, low);
+    for (int lane = 0; lane < Lanes; lane++) sp[lane] = on[lane] ? sp[lane] - 2 : sp[lane];
+    return true;
+}
+
+template<int Lanes>
+bool LaneGroup<Lanes>::Pop(const uint8_t* on, uint8_t* high, uint8_t* low) {
+    uint16_t upper[Lanes], lower[Lanes];
+    for (int lane = 0; lane < Lanes; lane++) {
+        lower[lane] = sp[lane];
+        upper[lane] = sp[lane] + 1;
+    }
+    if (!Gather(lower, on, low) || !Gather(upper, on, high)) return false;
+    for (int lane = 0; lane < Lanes; lane++) sp[lane] = on[lane] ? sp[lane] + 2 : sp[lane];
+    return true;
+}
+
+// ADD ADC SUB SBB ANA XRA ORA CMP, by the opcode's bits 3-5, with the
+// results of Add, Subtract, And, Or and Xor
+template<int Lanes>
+template<int Kind>
+void LaneGroup<Lanes>::Alu(const uint8_t* __restrict operand, const uint8_t* __restrict on) {
+    for (int lane = 0; lane < Lanes; lane++) {
+        uint8_t x = a[lane], value = operand[lane];
+        uint8_t carry = (Kind == 1 || Kind == 3) ? flags[lane] & FLAG_CY : 0;
+        uint8_t result, bits;
+        if (Kind <= 1) {
+            uint16_t answer = x + value + carry;
+            result = answer;
+            bits = (answer > 0xff ? FLAG_CY : 0) | (((x & 0xf) + (value & 0xf) + carry) > 0xf ? FLAG_AC : 0);
+        } else if (Kind <= 3 || Kind == 7) {
+            uint16_t answer = x - value - carry;
+            result = answer;
+            bits = ((answer >> 8) & FLAG_CY) | (((x & 0xf) + (~value & 0xf) + !carry) > 0xf ? FLAG_AC : 0);
+        } else if (Kind == 4) {
+            result = x & value;
+            bits = ((x | value) & 0x08) ? FLAG_AC : 0;
+        } else {
+            result = Kind == 5 ? x ^ value : x | value;
+            bits = 0;
+        }
+        if (Kind != 7) a[lane] = on[lane] ? result : x;
+        flags[lane] = on[lane] ? (flags[lane] & ~(FLAG_CY | FLAG_AC)) | bits : flags[lane];
+        zsp[lane] = on[lane] ? result : zsp[lane];
+        lazy[lane] = on[lane] ? 1 : lazy[lane];
+    }
+}
+
+// Executes op on the lanes in on, or returns false if the lanes cannot run
+// it together; nothing is changed then but flags a condition folded
+template<int Lanes>
+bool LaneGroup<Lanes>::ExecuteLanes(uint8_t op, const uint8_t* bytes, const uint8_t* __restrict on) {
+    alignas(64) uint8_t values[Lanes], taken[Lanes];
+    alignas(64) uint16_t address[Lanes];
+    uint16_t word = (bytes[2] << 8) | bytes[1];
+    bool jump = false;
+
+    // A pair as a 16 bit value per lane, and back
+    auto pair = [](const uint8_t* high, const uint8_t* low, int lane) -> uint16_t { return (high[lane] << 8) | low[lane]; };
+    auto setPair = [on](uint8_t* high, uint8_t* low, int lane, uint16_t value) {
+        high[lane] = on[lane] ? value >> 8 : high[lane];
+        low[lane] = on[lane] ? value & 0xff : low[lane];
+    };
+    auto pairOf = [this](int index, uint8_t*& high, uint8_t*& low) {
+        high = index == 0 ? b : index == 1 ? d : h;
+        low = index == 0 ? c : index == 1 ? e : l;
+    };
+    uint8_t *high = nullptr, *low = nullptr;
+
+    if (op >= 0x40 && op < 0x80 && op != 0x76) { // MOV
+        int target = (op >> 3) & 7;
+        if (target == 6) {
+            for (int lane = 0; lane < Lanes; lane++) address[lane] = pair(h, l, lane);
+            if (!Writable(address, on) || !Source(op & 7, on, values)) return false;
+            Scatter(address, on, values);
+        } else {
+            if (!Source(op & 7, on, values)) return false;
+            uint8_t *destination = Register(target);
+            for (int lane = 0; lane < Lanes; lane++) destination[lane] = on[lane] ? values[lane] : destination[lane];
+        }
+    } else if (op >= 0x80 && op < 0xc0) {
+        if (!Source(op & 7, on, values)) return false;
+        switch ((op >> 3) & 7) {
+            case 0: Alu<0>(values, on); break;
+            case 1: Alu<1>(values, on); break;
+            case 2: Alu<2>(values, on); break;
+            case 3: Alu<3>(values, on); break;
+            case 4: Alu<4>(values, on); break;
+            case 5: Alu<5>(values, on); break;
+            case 6: Alu<6>(values, on); break;
+            case 7: Alu<7>(values, on); break;
+        }
+    } else if ((op & 0xc7) == 0xc6) { // ADI ACI SUI SBI ANI XRI ORI CPI
+        for (int lane = 0; lane < Lanes; lane++) values[lane] = bytes[1];
+        switch ((op >> 3) & 7) {
+            case 0: Alu<0>(values, on); break;
+            case 1: Alu<1>(values, on); break;
+            case 2: Alu<2>(values, on); break;
+            case 3: Alu<3>(values, on); break;
+            case 4: Alu<4>(values, on); break;
+            case 5: Alu<5>(values, on); break;
+            case 6: Alu<6>(values, on); break;
+            case 7: Alu<7>(values, on); break;
+        }
+    } else if (op < 0x40 && (op & 0x07) == 0x06) { // MVI
+        int target = (op >> 3) & 7;
+        for (int lane = 0; lane < Lanes; lane++) values[lane] = bytes[1];
+        if (target == 6) {
+            for (int lane = 0; lane < Lanes; lane++) address[lane] = pair(h, l, lane);
+            if (!Writable(address, on)) return false;
+            Scatter(address, on, values);
+        } else {
+            uint8_t *destination = Register(target);
+            for (int lane = 0; lane < Lanes; lane++) destination[lane] = on[lane] ? bytes[1] : destination[lane];
+        }
+    } else if (op < 0x40 && (op & 0x06) == 0x04) { // INR DCR
+        int target = (op >> 3) & 7;
+        bool decrement = op & 1;
+        if (target == 6) {
+            for (int lane = 0; lane < Lanes; lane++) address[lane] = pair(h, l, lane);
+            if (!Writable(address, on) || !Gather(address, on, values)) return false;
+        } else {
+            const uint8_t *source = Register(target);
+            for (int lane = 0; lane < Lanes; lane++) values[lane] = source[lane];
+        }
+        for (int lane = 0; lane < Lanes; lane++) {
+            uint8_t result = decrement ? values[lane] - 1 : values[lane] + 1;
+            uint8_t ac = decrement ? ((result & 0xf) != 0xf ? FLAG_AC : 0) : ((result & 0xf) == 0 ? FLAG_AC : 0);
+            values[lane] = result;
+            flags[lane] = on[lane] ? (flags[lane] & ~FLAG_AC) | ac : flags[lane];
+            zsp[lane] = on[lane] ? result : zsp[lane];
+            lazy[lane] = on[lane] ? 1 : lazy[lane];
+        }
+        if (target == 6) {
+            Scatter(address, on, values);
+        } else {
+            uint8_t *destination = Register(target);
+            for (int lane = 0; lane < Lanes; lane++) destination[lane] = on[lane] ? values[lane] : destination[lane];
+        }
+    } else if (op < 0x40 && (op & 0x0f) == 0x01) { // LXI
+        if (op == 0x31) {
+            for (int lane = 0; lane < Lanes; lane++) sp[lane] = on[lane] ? word : sp[lane];
+        } else {
+            pairOf(op >> 4, high, low);
+            for (int lane = 0; lane < Lanes; lane++) setPair(high, low, lane, word);
+        }
+    } else if (op < 0x40 && (op & 0x07) == 0x03) { // INX DCX
+        uint16_t delta = (op & 0x08) ? 0xffff : 1;
+        if ((op >> 4) == 3) {
+            for (int lane = 0; lane < Lanes; lane++) sp[lane] = on[lane] ? sp[lane] + delta : sp[lane];
+        } else {
+            pairOf(op >> 4, high, low);
+            for (int lane = 0; lane < Lanes; lane++) setPair(high, low, lane, pair(high, low, lane) + delta);
+        }
+    } else if (op < 0x40 && (op & 0x0f) == 0x09) { // DAD
+        if ((op >> 4) != 3) pairOf(op >> 4, high, low);
+        for (int lane = 0; lane < Lanes; lane++) {
+            uint32_t result = pair(h, l, lane) + ((op >> 4) == 3 ? sp[lane] : pair(high, low, lane));
+            setPair(h, l, lane, result);
+            flags[lane] = on[lane] ? (flags[lane] & ~FLAG_CY) | (result > 0xffff ? FLAG_CY : 0) : flags[lane];
+        }
+    } else if (op == 0x0a || op == 0x1a || op == 0x3a) { // LDAX B, LDAX D, LDA
+        for (int lane = 0; lane < Lanes; lane++) address[lane] = op == 0x0a ? pair(b, c, lane) : op == 0x1a ? pair(d, e, lane) : word;
+        if (!Gather(address, on, values)) return false;
+        for (int lane = 0; lane < Lanes; lane++) a[lane] = on[lane] ? values[lane] : a[lane];
+    } else if (op == 0x02 || op == 0x12 || op == 0x32) { // STAX B, STAX D, STA
+        for (int lane = 0; lane < Lanes; lane++) address[lane] = op == 0x02 ? pair(b, c, lane) : op == 0x12 ? pair(d, e, lane) : word;
+        if (!Writable(address, on)) return false;
+        Scatter(address, on, a);
+    } else if (op == 0x07 || op == 0x0f || op == 0x17 || op == 0x1f) { // RLC RRC RAL RAR
+        for (int lane = 0; lane < Lanes; lane++) {
+            uint8_t x = a[lane], carry = flags[lane] & FLAG_CY, result, out;
+            if (op == 0x07) { result = (x << 1) | (x >> 7); out = x >> 7; }
+            else if (op == 0x0f) { result = ((x & 1) << 7) | (x >> 1); out = x & 1; }
+            else if (op == 0x17) { result = (x << 1) | carry; out = x >> 7; }
+            else { result = (x >> 1) | (carry << 7); out = x & 1; }
+            a[lane] = on[lane] ? result : x;
+            flags[lane] = on[lane] ? (flags[lane] & ~FLAG_CY) | out : flags[lane];
+        }
+    } else if (op == 0x2f) { // CMA
+        for (int lane = 0; lane < Lanes; lane++) a[lane] = on[lane] ? ~a[lane] : a[lane];
+    } else if (op == 0x37 || op == 0x3f) { // STC CMC
+        for (int lane = 0; lane < Lanes; lane++) {
+            uint8_t carry = op == 0x37 ? FLAG_CY : (flags[lane] & FLAG_CY) ^ FLAG_CY;
+            flags[lane] = on[lane] ? (flags[lane] & ~FLAG_CY) | carry : flags[lane];
+        }
+    } else if (op == 0xeb) { // XCHG
+        for (int lane = 0; lane < Lanes; lane++) {
+            uint8_t x = d[lane], y = e[lane];
+            d[lane] = on[lane] ? h[lane] : x;
+            e[lane] = on[lane] ? l[lane] : y;
+            h[lane] = on[lane] ? x : h[lane];
+            l[lane] = on[lane] ? y : l[lane];
+        }
+    } else if (op < 0x40 && (op & 0xc7) == 0x00) { // NOP, and its undocumented copies
+    } else if (op == 0xf3 || op == 0xfb) { // DI EI: the flag stays in the instance
+        for (int lane = 0; lane < count; lane++) {
+            if (on[lane]) instances[lane]->processor.int_enable = op == 0xfb;
+        }
+    } else if (op == 0xc3 || op == 0xcb) { // JMP
+        for (int lane = 0; lane < Lanes; lane++) pc[lane] = on[lane] ? word : pc[lane];
+        jump = true;
+    } else if ((op & 0xc7) == 0xc2) { // Jcc
+        Conditions((op >> 3) & 7, on, taken);
+        for (int lane = 0; lane < Lanes; lane++) pc[lane] = on[lane] ? (taken[lane] ? word : pc[lane] + 3) : pc[lane];
+        jump = true;
+    } else if ((op & 0xc7) == 0xc4 || op == 0xcd || op == 0xdd || op == 0xed || op == 0xfd) { // Ccc, CALL
+        bool conditional = (op & 0xc7) == 0xc4;
+        if (conditional) Conditions((op >> 3) & 7, on, taken);
+        else std::copy(on, on + Lanes, taken);
+        alignas(64) uint8_t returnHigh[Lanes], returnLow[Lanes];
+        for (int lane = 0; lane < Lanes; lane++) {
+            uint16_t ret = pc[lane] + 3;
+            returnHigh[lane] = ret >> 8;
+            returnLow[lane] = ret & 0xff;
+        }
+        if (!Push(taken, returnHigh, returnLow)) return false;
+        for (int lane = 0; lane < Lanes; lane++) {
+            pc[lane] = on[lane] ? (taken[lane] ? word : pc[lane] + 3) : pc[lane];
+            left[lane] -= conditional && taken[lane] ? 6 : 0;
+        }
+        jump = true;
+    } else if ((op & 0xc7) == 0xc0 || op == 0xc9 || op == 0xd9) { // Rcc, RET
+        bool conditional = (op & 0xc7) == 0xc0;
+        if (conditional) Conditions((op >> 3) & 7, on, taken);
+        else std::copy(on, on + Lanes, taken);
+        alignas(64) uint8_t upper[Lanes];
+        if (!Pop(taken, upper, values)) return false;
+        for (int lane = 0; lane < Lanes; lane++) {
+            pc[lane] = on[lane] ? (taken[lane] ? (upper[lane] << 8) | values[lane] : pc[lane] + 1) : pc[lane];
+            left[lane] -= conditional && taken[lane] ? 6 : 0;
+        }
+        jump = true;
+    } else if ((op & 0xcf) == 0xc5) { // PUSH B D H PSW
+        if (op == 0xf5) {
+            for (int lane = 0; lane < Lanes; lane++) {
+                // Folded first, as Flags does
+                uint8_t folded = (flags[lane] & ~FLAGS_ZSP) | ZSP_TABLE.value[zsp[lane]];
+                values[lane] = lazy[lane] ? folded : flags[lane];
+            }
+            if (!Push(on, a, values)) return false;
+            for (int lane = 0; lane < Lanes; lane++) {
+                flags[lane] = on[lane] ? values[lane] : flags[lane];
+                lazy[lane] = on[lane] ? 0 : lazy[lane];
+            }
+        } else {
+            pairOf((op >> 4) - 0xc, high, low);
+            if (!Push(on, high, low)) return false;
+        }
+    } else if ((op & 0xcf) == 0xc1) { // POP B D H PSW
+        alignas(64) uint8_t upper[Lanes];
+        if (!Pop(on, upper, values)) return false;
+        if (op == 0xf1) {
+            high = a;
+            for (int lane = 0; lane < Lanes; lane++) {
+                uint8_t psw = (values[lane] & (FLAGS_ZSP | FLAG_AC | FLAG_CY)) | FLAG_ALWAYS_ONE;
+                flags[lane] = on[lane] ? psw : flags[lane];
+                lazy[lane] = on[lane] ? 0 : lazy[lane];
+            }
+        } else {
+            pairOf((op >> 4) - 0xc, high, low);
+            for (int lane = 0; lane < Lanes; lane++) low[lane] = on[lane] ? values[lane] : low[lane];
+        }
+        for (int lane = 0; lane < Lanes; lane++) high[lane] = on[lane] ? upper[lane] : high[lane];
+    } else if (op == 0x22 || op == 0x2a) { // SHLD LHLD
+        uint16_t above[Lanes];
+        for (int lane = 0; lane < Lanes; lane++) {
+            address[lane] = word;
+            above[lane] = word + 1;
+        }
+        if (op == 0x22) {
+            if (!Writable(address, on) || !Writable(above, on)) return false;
+            Scatter(address, on, l);
+            Scatter(above, on, h);
+        } else {
+            alignas(64) uint8_t upper[Lanes];
+            if (!Gather(address, on, values) || !Gather(above, on, upper)) return false;
+            for (int lane = 0; lane < Lanes; lane++) {
+                l[lane] = on[lane] ? values[lane] : l[lane];
+                h[lane] = on[lane] ? upper[lane] : h[lane];
+            }
+        }
+    } else if (op == 0xe3) { // XTHL
+        uint16_t above[Lanes];
+        alignas(64) uint8_t upper[Lanes];
+        for (int lane = 0; lane < Lanes; lane++) {
+            address[lane] = sp[lane];
+            above[lane] = sp[lane] + 1;
+        }
+        if (!Writable(address, on) || !Writable(above, on)) return false;
+        if (!Gather(address, on, values) || !Gather(above, on, upper)) return false;
+        Scatter(address, on, l);
+        Scatter(above, on, h);
+        for (int lane = 0; lane < Lanes; lane++) {
+            l[lane] = on[lane] ? values[lane] : l[lane];
+            h[lane] = on[lane] ? upper[lane] : h[lane];
+        }
+    } else {
+        return false;
+    }
+
+    uint8_t length = OPCODE_LENGTHS[op], cost = OPCODE_CYCLES[op];
+    if (!jump) {
+        for (int lane = 0; lane < Lanes; lane++) pc[lane] = on[lane] ? pc[lane] + length : pc[lane];
+    }
+    for (int lane = 0; lane < Lanes; lane++) {
+        left[lane] -= on[lane] ? cost : 0;
+        retired[lane] += on[lane] & 1;
+    }
+    return true;
+}
+
+template class LaneGroup<16>;
+template class LaneGroup<32>;
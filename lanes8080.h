@@ -0,0 +1,103 @@
+#ifndef _LANES8080_H_
+#define _LANES8080_H_
+
+#include <stdint.h>
+#include <vector>
+#include "emulator8080.h"
+
+// Experimental lane-parallel core for running many instances of the same
+// program, such as replays and fuzz cases that mostly follow the same path.
+// The registers of up to Lanes instances are held as structure of arrays,
+// one array per register, and the lanes that share a pc and instruction
+// bytes execute that instruction together: every lane computes the result
+// and a mask blends it into the lanes taking part, so the register, ALU and
+// branch bodies are plain loops over the lanes that the compiler turns into
+// SIMD. Memory operands are gathered and scattered lane by lane through
+// each instance's own memory map.
+//
+// Each step runs the lanes at the lowest pc, which lets lanes that took
+// different branches meet again at the code after them. A lane alone at its
+// pc, or at an instruction the lanes do not handle (IN, OUT, RST, HLT, DAA,
+// PCHL, SPHL, anything touching a handler page), is peeled off to its
+// instance's threaded core for one instruction.
+//
+// Instances keep their memory, map, I/O and events; everything but the
+// registers stays in the instance, and the registers are written back
+// before any event is dispatched.
+template<int Lanes>
+class LaneGroup {
+    public:
+        // Narrower groups lose to the threaded core on the lanes' overhead
+        static_assert(Lanes == 16 || Lanes == 32, "lane groups are 16 or 32 wide");
+
+        // At most Lanes initialized instances, which must outlive the group
+        explicit LaneGroup(const std::vector<Emulator8080*>& instances);
+
+        // Runs every instance until its cycle count reaches its target, as
+        // Emulator8080::RunFor(target - Cycles()) on the threaded backend
+        // would; a halted instance with interrupts disabled stops early. The
+        // memory maps must not change while it runs.
+        void RunTo(const uint64_t* targets);
+        void RunFor(uint64_t cycles);
+
+        int Count() const { return count; }
+        // Instructions retired by lanes executing together, and by lanes
+        // peeled off to their scalar core
+        uint64_t LockstepInstructions() const { return lockstep; }
+        uint64_t ScalarInstructions() const { return scalar; }
+        // Instructions dispatched: one per lock-step across the lanes, one
+        // per peeled instruction
+        uint64_t Dispatches() const { return dispatches; }
+
+    private:
+        typedef Emulator8080::State8080 State8080;
+
+        Emulator8080 *instances[Lanes] = {};
+        int count = 0;
+
+        // Register file, one array per register
+        alignas(64) uint8_t a[Lanes], b[Lanes], c[Lanes], d[Lanes], e[Lanes], h[Lanes], l[Lanes];
+        alignas(64) uint8_t flags[Lanes], zsp[Lanes], lazy[Lanes];
+        alignas(64) uint16_t sp[Lanes], pc[Lanes];
+
+        uint64_t target[Lanes];     // cycle each lane runs to
+        uint64_t until[Lanes];      // next event or the target, whichever is first
+        // The instance keeps the cycle and instruction totals; the lanes
+        // count narrow deltas from the last Load so every step's updates
+        // and checks stay vectorized
+        alignas(64) int32_t left[Lanes];        // cycles until the lane reaches until
+        alignas(64) uint32_t retired[Lanes];    // instructions since the lane was loaded
+        int32_t loaded[Lanes];                  // left when the lane was loaded
+        alignas(64) uint8_t running[Lanes] = {};    // 0xff while the lane has budget left
+        alignas(64) uint8_t sharedMap[Lanes] = {};  // 0xff on the same ROM set and map as the first lane
+        // The instances' modifiedPages as a byte per page and lane, so one
+        // vector tells whether a page still holds the ROM set's image in
+        // every lane; synced as stores set new bits
+        alignas(64) uint8_t modified[Emulator8080::PAGES][Lanes];
+        uint64_t modifiedSeen[Lanes][Emulator8080::PAGES / 64];
+
+        uint64_t lockstep = 0;
+        uint64_t scalar = 0;
+        uint64_t dispatches = 0;
+
+        void Load(int lane);
+        void Store(int lane);
+        bool Settle(int lane);
+        void SyncModified(int lane);
+        bool FetchLane(int lane, uint8_t* bytes);
+        int Select(uint8_t* on, uint8_t* bytes);
+        void StepScalar(int lane);
+
+        uint8_t* Register(int index);
+        bool Gather(const uint16_t* address, const uint8_t* on, uint8_t* values);
+        bool Writable(const uint16_t* address, const uint8_t* on);
+        void Scatter(const uint16_t* address, const uint8_t* on, const uint8_t* values);
+        bool Source(int index, const uint8_t* on, uint8_t* __restrict values);
+        void Conditions(int condition, const uint8_t* __restrict on, uint8_t* __restrict taken);
+        bool Push(const uint8_t* on, const uint8_t* high, const uint8_t* low);
+        bool Pop(const uint8_t* on, uint8_t* high, uint8_t* low);
+        template<int Kind> void Alu(const uint8_t* __restrict operand, const uint8_t* __restrict on);
+        bool ExecuteLanes(uint8_t op, const uint8_t* bytes, const uint8_t* __restrict on);
+};
+
+#endif
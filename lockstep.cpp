@@ -0,0 +1,117 @@
+#include "lockstep.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char* ENGINE_NAMES[] = { "switch", "threaded", "blocks", "jit" };
+// Instructions a leading JIT runs per step: the longest block fits
+static const uint32_t JIT_STEP = 64;
+
+LockstepHarness::LockstepHarness(const RomSet& roms, Engine leftEngine, Engine rightEngine)
+    : leftEngine(leftEngine), rightEngine(rightEngine) {
+    left.Initialize(roms);
+    right.Initialize(roms);
+    const Emulator8080::Backend backends[] = {
+        Emulator8080::BACKEND_THREADED, Emulator8080::BACKEND_THREADED,
+        Emulator8080::BACKEND_BLOCK_CACHE, Emulator8080::BACKEND_JIT
+    };
+    left.SetBackend(backends[leftEngine]);
+    right.SetBackend(backends[rightEngine]);
+}
+
+const char* LockstepHarness::EngineName(Engine engine) {
+    return ENGINE_NAMES[engine];
+}
+
+bool LockstepHarness::ParseEngine(const char* name, Engine& engine) {
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(name, ENGINE_NAMES[i]) == 0) {
+            engine = (Engine)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void LockstepHarness::SetInputPort(uint8_t port, uint8_t value) {
+    left.SetInputPort(port, value);
+    right.SetInputPort(port, value);
+}
+
+void LockstepHarness::Step(Emulator8080& emulator, Engine engine, uint32_t instructions) {
+    if (engine == ENGINE_SWITCH) emulator.AdvanceEmulationStep();
+    else emulator.Run(instructions);
+}
+
+bool LockstepHarness::Run(uint64_t instructions) {
+    bool leftLeads = leftEngine == ENGINE_JIT && rightEngine != ENGINE_JIT;
+    Emulator8080& leader = leftLeads ? left : right;
+    Emulator8080& follower = leftLeads ? right : left;
+    Engine leaderEngine = leftLeads ? leftEngine : rightEngine;
+    Engine followerEngine = leftLeads ? rightEngine : leftEngine;
+    while (left.Instructions() < instructions) {
+        if (left.Halted() && right.Halted()) return true;
+        uint16_t leftPc = left.ProgramCounter();
+        uint16_t rightPc = right.ProgramCounter();
+
+        Step(leader, leaderEngine, leaderEngine == ENGINE_JIT ? JIT_STEP : 1);
+        while (follower.Instructions() < leader.Instructions() && !follower.Halted()) {
+            Step(follower, followerEngine, leader.Instructions() - follower.Instructions());
+        }
+        if (!Compare(leftPc, rightPc)) return false;
+    }
+    return true;
+}
+
+int LockstepHarness::MemoryDifference() const {
+    uint64_t leftPages[Emulator8080::PAGES / 64], rightPages[Emulator8080::PAGES / 64];
+    left.ModifiedPages(leftPages);
+    right.ModifiedPages(rightPages);
+    for (int page = 0; page < Emulator8080::PAGES; page++) {
+        uint64_t bit = 1ull << (page & 63);
+        if (!((leftPages[page >> 6] | rightPages[page >> 6]) & bit)) continue;
+        const uint8_t *l = left.Memory() + page * Emulator8080::PAGE_SIZE;
+        const uint8_t *r = right.Memory() + page * Emulator8080::PAGE_SIZE;
+        if (memcmp(l, r, Emulator8080::PAGE_SIZE) == 0) continue;
+        for (int offset = 0; ; offset++) {
+            if (l[offset] != r[offset]) return page * Emulator8080::PAGE_SIZE + offset;
+        }
+    }
+    return -1;
+}
+
+static void AppendRegisters(std::string& out, const char* name, const Emulator8080::Registers& r) {
+    char line[256];
+    snprintf(line, sizeof(line), "  %-8s A=%02x BC=%02x%02x DE=%02x%02x HL=%02x%02x SP=%04x PC=%04x F=%02x INTE=%d HALT=%d cycles=%llu instructions=%llu\n",
+             name, r.a, r.b, r.c, r.d, r.e, r.h, r.l, r.sp, r.pc, r.flags, r.int_enable, r.halted,
+             (unsigned long long)r.cycles, (unsigned long long)r.instructions);
+    out += line;
+}
+
+bool LockstepHarness::Compare(uint16_t leftPc, uint16_t rightPc) {
+    Emulator8080::Registers l = left.Snapshot();
+    Emulator8080::Registers r = right.Snapshot();
+    const char *what = NULL;
+    if (l.instructions != r.instructions) what = "instruction count";
+    else if (l.pc != r.pc) what = "pc";
+    else if (l.a != r.a || l.b != r.b || l.c != r.c || l.d != r.d || l.e != r.e || l.h != r.h || l.l != r.l || l.sp != r.sp) what = "registers";
+    else if (l.flags != r.flags) what = "flags";
+    else if (l.cycles != r.cycles) what = "cycle count";
+    else if (l.int_enable != r.int_enable || l.halted != r.halted) what = "interrupt enable or halt state";
+    int address = what == NULL ? MemoryDifference() : -1;
+    if (address >= 0) what = "memory";
+    if (what == NULL) return true;
+
+    char line[256];
+    snprintf(line, sizeof(line), "%s diverge in %s after instruction %llu (step from pc %04x / %04x, opcode %02x):\n",
+             EngineName(leftEngine), what, (unsigned long long)l.instructions, leftPc, rightPc, left.Peek(leftPc));
+    divergence = line;
+    AppendRegisters(divergence, EngineName(leftEngine), l);
+    AppendRegisters(divergence, EngineName(rightEngine), r);
+    if (address >= 0) {
+        snprintf(line, sizeof(line), "  memory at %04x: %s %02x, %s %02x\n", address, EngineName(leftEngine),
+                 left.Memory()[address], EngineName(rightEngine), right.Memory()[address]);
+        divergence += line;
+    }
+    return false;
+}
@@ -0,0 +1,53 @@
+#ifndef _LOCKSTEP_H_
+#define _LOCKSTEP_H_
+
+#include <string>
+#include "emulator8080.h"
+#include "romset.h"
+
+// Runs two emulator cores on the same ROM set in lock-step and stops at the
+// first point where they disagree on registers, flags, cycle count or the
+// memory either has stored to since reset.
+//
+// Cores sync on the instruction count: one core leads by a step and the
+// other runs until it has retired the same number of instructions. A JIT
+// leads with steps long enough for any block, since it only runs a block
+// natively when its budget covers the whole block; the others step one
+// instruction at a time. Stores take the same fast and slow paths they
+// take outside the harness.
+class LockstepHarness {
+    public:
+        enum Engine {
+            ENGINE_SWITCH,      // Emulate8080Operation, the reference switch
+            ENGINE_THREADED,
+            ENGINE_BLOCK_CACHE,
+            ENGINE_JIT
+        };
+
+        LockstepHarness(const RomSet& roms, Engine left, Engine right);
+
+        void SetInputPort(uint8_t port, uint8_t value);
+        // Runs until a divergence, until both cores halt or until the given
+        // number of instructions; returns false on divergence
+        bool Run(uint64_t instructions);
+        const std::string& Divergence() const { return divergence; }
+        uint64_t Instructions() const { return left.Instructions(); }
+        bool Halted() const { return left.Halted() && right.Halted(); }
+        uint16_t ProgramCounter() const { return left.ProgramCounter(); }
+
+        static const char* EngineName(Engine engine);
+        static bool ParseEngine(const char* name, Engine& engine);
+
+    private:
+        Emulator8080 left, right;
+        Engine leftEngine, rightEngine;
+        std::string divergence;
+
+        // Runs up to the given number of instructions; the switch runs one
+        void Step(Emulator8080& emulator, Engine engine, uint32_t instructions);
+        bool Compare(uint16_t leftPc, uint16_t rightPc);
+        // First address of memory the cores hold differently, or -1
+        int MemoryDifference() const;
+};
+
+#endif
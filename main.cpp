@@ -1,11 +1,120 @@
 #include <iostream>
+#include <cstring>
+#include <chrono>
+#include <thread>
 #include "window.h"
+#include "emulationthread.h"
 #include "emulator8080.h"
+#include "renderer.h"
+#include "spaceinvaders.h"
 
-int main(){
+// Keyboard to input port bits: C inserts a coin, 1 and 2 start a game,
+// space/arrows play player 1 and W/A/D player 2
+struct KeyBinding {
+    SDL_Keycode key;
+    uint8_t     port;
+    uint8_t     mask;
+};
+static const KeyBinding KEY_BINDINGS[] = {
+    { SDLK_c,     1, 0x01 },
+    { SDLK_2,     1, 0x02 },
+    { SDLK_1,     1, 0x04 },
+    { SDLK_SPACE, 1, 0x10 },
+    { SDLK_LEFT,  1, 0x20 },
+    { SDLK_RIGHT, 1, 0x40 },
+    { SDLK_w,     2, 0x10 },
+    { SDLK_a,     2, 0x20 },
+    { SDLK_d,     2, 0x40 },
+};
+
+int main(int argc, char* argv[]){
     Emulator8080 emulator;
-    emulator.Initialize();
-    while(true) {
-        emulator.AdvanceEmulationStep();
+    const char* manifest = "invaders.manifest";
+    bool headless = false;
+    const char* recordFile = NULL;
+    const char* traceFile = NULL;
+    const char* profileFile = NULL;
+    const char* stacksFile = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) traceFile = argv[++i];
+        else if (strcmp(argv[i], "--manifest") == 0 && i + 1 < argc) manifest = argv[++i];
+        else if (strcmp(argv[i], "--block-cache") == 0) emulator.SetBackend(Emulator8080::BACKEND_BLOCK_CACHE);
+        else if (strcmp(argv[i], "--jit") == 0) emulator.SetBackend(Emulator8080::BACKEND_JIT);
+        else if (strcmp(argv[i], "--jit-verify") == 0) { emulator.SetBackend(Emulator8080::BACKEND_JIT); emulator.SetJitVerify(true); }
+        else if (strcmp(argv[i], "--headless") == 0) headless = true;
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordFile = argv[++i];
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) profileFile = argv[++i];
+        else if (strcmp(argv[i], "--profile-stacks") == 0 && i + 1 < argc) stacksFile = argv[++i];
+    }
+    emulator.Initialize(manifest);
+    ScheduleVideoInterrupts(emulator);
+    TraceWriter trace;
+    if (traceFile && trace.Open(traceFile)) emulator.SetTraceWriter(&trace);
+    Profiler profiler;
+    if (profileFile || stacksFile) emulator.SetProfiler(&profiler);
+    // Written once the emulation thread has stopped
+    auto writeProfile = [&]() {
+        emulator.SetProfiler(nullptr);
+        const char* paths[] = { profileFile, stacksFile };
+        for (int i = 0; i < 2; i++) {
+            if (paths[i] == NULL) continue;
+            FILE* out = fopen(paths[i], "w");
+            if (out == NULL) {
+                printf("error: Couldn't create %s\n", paths[i]);
+                continue;
+            }
+            if (i == 0) profiler.WriteJson(out);
+            else profiler.WriteStacks(out);
+            fclose(out);
+        }
+    };
+
+    // Headless runs still render every frame, into the handoff buffers
+    EmulationThread emulation(emulator);
+    InputRecorder recorder;
+    if (recordFile) {
+        if (!recorder.Open(recordFile)) exit(1);
+        emulation.SetRecorder(&recorder);
+    }
+    if (headless) {
+        emulation.Run();
+        writeProfile();
+        return 1;
+    }
+
+    Window window;
+    if (!window.Initialize()) exit(1);
+    emulation.Start();
+
+    // This thread only polls input and presents; tab fast-forwards and
+    // backspace rewinds while held, F5 saves a state and F9 loads it
+    bool quit = false;
+    uint64_t shown = 0;
+    auto onKey = [&](SDL_Keycode key, bool pressed) {
+        if (key == SDLK_ESCAPE) quit = true;
+        else if (key == SDLK_TAB) emulation.SetFastForward(pressed);
+        else if (key == SDLK_BACKSPACE) emulation.SetRewinding(pressed);
+        else if (key == SDLK_F5 && pressed) emulation.RequestSave();
+        else if (key == SDLK_F9 && pressed) emulation.RequestLoad();
+        for (const KeyBinding& binding : KEY_BINDINGS) {
+            if (binding.key == key) emulation.PushInput({binding.port, binding.mask, pressed});
+        }
+    };
+    while (!quit && emulation.Running()) {
+        if (!window.PollEvents(onKey)) break;
+        if (!emulation.Frames().Acquire()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        // The texture holds the frame shown last; upload only what changed
+        // since, or everything if frames were skipped in between
+        const EmulationThread::Frame& frame = emulation.Frames().Front();
+        int first = 0, count = Renderer::WIDTH;
+        if (frame.number == shown + 1) frame.changed.Span(first, count);
+        window.Present(frame.pixels.data(), first, count);
+        shown = frame.number;
     }
+    emulation.Stop();
+    writeProfile();
+    return 0;
 }
@@ -0,0 +1,319 @@
+#ifndef _OPCODES8080_H_
+#define _OPCODES8080_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <utility>
+
+// Immediate operand that follows the opcode byte
+enum OperandKind : uint8_t {
+    OPERAND_NONE,
+    OPERAND_BYTE,       // data or port number
+    OPERAND_WORD,       // 16 bit data (LXI)
+    OPERAND_ADDRESS,    // memory address (LDA, STA, LHLD, SHLD)
+    OPERAND_TARGET,     // code address (jumps and calls)
+};
+
+// Where execution goes after the instruction
+enum Flow : uint8_t {
+    FLOW_NEXT,                  // falls through
+    FLOW_JUMP,                  // to the target only
+    FLOW_BRANCH,                // to the target or falls through
+    FLOW_CALL,                  // to the target, returning to the next instruction
+    FLOW_RESTART,               // RST: a call to its vector
+    FLOW_RETURN,                // to the return address only
+    FLOW_CONDITIONAL_RETURN,    // to the return address or falls through
+    FLOW_INDIRECT,              // PCHL: somewhere only known at run time
+    FLOW_HALT,                  // waits for an interrupt, then falls through
+};
+
+// One row per opcode. Cycles are machine cycles (states) on a 2 MHz 8080;
+// conditional CALL and RET list the not-taken cost, and
+// ConditionalCall/ConditionalReturn add the extra 6 states when the branch
+// is taken. Register operands are part of the text; immediates are
+// described by the operand kind. The undocumented aliases decode as the
+// instructions they execute as.
+struct OpcodeInfo {
+    const char  *mnemonic;
+    const char  *registers;
+    uint8_t     length;     // bytes, opcode included
+    uint8_t     cycles;
+    OperandKind operand;
+    Flow        flow;
+};
+
+constexpr OpcodeInfo OPCODE_INFO[256] = {
+    { "NOP", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 00
+    { "LXI", "B", 3, 10, OPERAND_WORD, FLOW_NEXT }, // 01
+    { "STAX", "B", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 02
+    { "INX", "B", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 03
+    { "INR", "B", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 04
+    { "DCR", "B", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 05
+    { "MVI", "B", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // 06
+    { "RLC", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 07
+    { "NOP", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 08
+    { "DAD", "B", 1, 10, OPERAND_NONE, FLOW_NEXT }, // 09
+    { "LDAX", "B", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 0a
+    { "DCX", "B", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 0b
+    { "INR", "C", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 0c
+    { "DCR", "C", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 0d
+    { "MVI", "C", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // 0e
+    { "RRC", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 0f
+    { "NOP", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 10
+    { "LXI", "D", 3, 10, OPERAND_WORD, FLOW_NEXT }, // 11
+    { "STAX", "D", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 12
+    { "INX", "D", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 13
+    { "INR", "D", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 14
+    { "DCR", "D", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 15
+    { "MVI", "D", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // 16
+    { "RAL", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 17
+    { "NOP", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 18
+    { "DAD", "D", 1, 10, OPERAND_NONE, FLOW_NEXT }, // 19
+    { "LDAX", "D", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 1a
+    { "DCX", "D", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 1b
+    { "INR", "E", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 1c
+    { "DCR", "E", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 1d
+    { "MVI", "E", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // 1e
+    { "RAR", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 1f
+    { "NOP", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 20
+    { "LXI", "H", 3, 10, OPERAND_WORD, FLOW_NEXT }, // 21
+    { "SHLD", "", 3, 16, OPERAND_ADDRESS, FLOW_NEXT }, // 22
+    { "INX", "H", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 23
+    { "INR", "H", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 24
+    { "DCR", "H", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 25
+    { "MVI", "H", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // 26
+    { "DAA", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 27
+    { "NOP", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 28
+    { "DAD", "H", 1, 10, OPERAND_NONE, FLOW_NEXT }, // 29
+    { "LHLD", "", 3, 16, OPERAND_ADDRESS, FLOW_NEXT }, // 2a
+    { "DCX", "H", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 2b
+    { "INR", "L", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 2c
+    { "DCR", "L", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 2d
+    { "MVI", "L", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // 2e
+    { "CMA", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 2f
+    { "NOP", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 30
+    { "LXI", "SP", 3, 10, OPERAND_WORD, FLOW_NEXT }, // 31
+    { "STA", "", 3, 13, OPERAND_ADDRESS, FLOW_NEXT }, // 32
+    { "INX", "SP", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 33
+    { "INR", "M", 1, 10, OPERAND_NONE, FLOW_NEXT }, // 34
+    { "DCR", "M", 1, 10, OPERAND_NONE, FLOW_NEXT }, // 35
+    { "MVI", "M", 2, 10, OPERAND_BYTE, FLOW_NEXT }, // 36
+    { "STC", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 37
+    { "NOP", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 38
+    { "DAD", "SP", 1, 10, OPERAND_NONE, FLOW_NEXT }, // 39
+    { "LDA", "", 3, 13, OPERAND_ADDRESS, FLOW_NEXT }, // 3a
+    { "DCX", "SP", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 3b
+    { "INR", "A", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 3c
+    { "DCR", "A", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 3d
+    { "MVI", "A", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // 3e
+    { "CMC", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 3f
+    { "MOV", "B,B", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 40
+    { "MOV", "B,C", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 41
+    { "MOV", "B,D", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 42
+    { "MOV", "B,E", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 43
+    { "MOV", "B,H", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 44
+    { "MOV", "B,L", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 45
+    { "MOV", "B,M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 46
+    { "MOV", "B,A", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 47
+    { "MOV", "C,B", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 48
+    { "MOV", "C,C", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 49
+    { "MOV", "C,D", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 4a
+    { "MOV", "C,E", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 4b
+    { "MOV", "C,H", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 4c
+    { "MOV", "C,L", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 4d
+    { "MOV", "C,M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 4e
+    { "MOV", "C,A", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 4f
+    { "MOV", "D,B", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 50
+    { "MOV", "D,C", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 51
+    { "MOV", "D,D", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 52
+    { "MOV", "D,E", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 53
+    { "MOV", "D,H", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 54
+    { "MOV", "D,L", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 55
+    { "MOV", "D,M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 56
+    { "MOV", "D,A", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 57
+    { "MOV", "E,B", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 58
+    { "MOV", "E,C", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 59
+    { "MOV", "E,D", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 5a
+    { "MOV", "E,E", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 5b
+    { "MOV", "E,H", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 5c
+    { "MOV", "E,L", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 5d
+    { "MOV", "E,M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 5e
+    { "MOV", "E,A", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 5f
+    { "MOV", "H,B", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 60
+    { "MOV", "H,C", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 61
+    { "MOV", "H,D", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 62
+    { "MOV", "H,E", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 63
+    { "MOV", "H,H", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 64
+    { "MOV", "H,L", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 65
+    { "MOV", "H,M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 66
+    { "MOV", "H,A", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 67
+    { "MOV", "L,B", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 68
+    { "MOV", "L,C", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 69
+    { "MOV", "L,D", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 6a
+    { "MOV", "L,E", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 6b
+    { "MOV", "L,H", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 6c
+    { "MOV", "L,L", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 6d
+    { "MOV", "L,M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 6e
+    { "MOV", "L,A", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 6f
+    { "MOV", "M,B", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 70
+    { "MOV", "M,C", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 71
+    { "MOV", "M,D", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 72
+    { "MOV", "M,E", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 73
+    { "MOV", "M,H", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 74
+    { "MOV", "M,L", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 75
+    { "HLT", "", 1, 7, OPERAND_NONE, FLOW_HALT }, // 76
+    { "MOV", "M,A", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 77
+    { "MOV", "A,B", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 78
+    { "MOV", "A,C", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 79
+    { "MOV", "A,D", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 7a
+    { "MOV", "A,E", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 7b
+    { "MOV", "A,H", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 7c
+    { "MOV", "A,L", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 7d
+    { "MOV", "A,M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 7e
+    { "MOV", "A,A", 1, 5, OPERAND_NONE, FLOW_NEXT }, // 7f
+    { "ADD", "B", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 80
+    { "ADD", "C", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 81
+    { "ADD", "D", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 82
+    { "ADD", "E", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 83
+    { "ADD", "H", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 84
+    { "ADD", "L", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 85
+    { "ADD", "M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 86
+    { "ADD", "A", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 87
+    { "ADC", "B", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 88
+    { "ADC", "C", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 89
+    { "ADC", "D", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 8a
+    { "ADC", "E", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 8b
+    { "ADC", "H", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 8c
+    { "ADC", "L", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 8d
+    { "ADC", "M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 8e
+    { "ADC", "A", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 8f
+    { "SUB", "B", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 90
+    { "SUB", "C", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 91
+    { "SUB", "D", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 92
+    { "SUB", "E", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 93
+    { "SUB", "H", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 94
+    { "SUB", "L", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 95
+    { "SUB", "M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 96
+    { "SUB", "A", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 97
+    { "SBB", "B", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 98
+    { "SBB", "C", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 99
+    { "SBB", "D", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 9a
+    { "SBB", "E", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 9b
+    { "SBB", "H", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 9c
+    { "SBB", "L", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 9d
+    { "SBB", "M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // 9e
+    { "SBB", "A", 1, 4, OPERAND_NONE, FLOW_NEXT }, // 9f
+    { "ANA", "B", 1, 4, OPERAND_NONE, FLOW_NEXT }, // a0
+    { "ANA", "C", 1, 4, OPERAND_NONE, FLOW_NEXT }, // a1
+    { "ANA", "D", 1, 4, OPERAND_NONE, FLOW_NEXT }, // a2
+    { "ANA", "E", 1, 4, OPERAND_NONE, FLOW_NEXT }, // a3
+    { "ANA", "H", 1, 4, OPERAND_NONE, FLOW_NEXT }, // a4
+    { "ANA", "L", 1, 4, OPERAND_NONE, FLOW_NEXT }, // a5
+    { "ANA", "M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // a6
+    { "ANA", "A", 1, 4, OPERAND_NONE, FLOW_NEXT }, // a7
+    { "XRA", "B", 1, 4, OPERAND_NONE, FLOW_NEXT }, // a8
+    { "XRA", "C", 1, 4, OPERAND_NONE, FLOW_NEXT }, // a9
+    { "XRA", "D", 1, 4, OPERAND_NONE, FLOW_NEXT }, // aa
+    { "XRA", "E", 1, 4, OPERAND_NONE, FLOW_NEXT }, // ab
+    { "XRA", "H", 1, 4, OPERAND_NONE, FLOW_NEXT }, // ac
+    { "XRA", "L", 1, 4, OPERAND_NONE, FLOW_NEXT }, // ad
+    { "XRA", "M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // ae
+    { "XRA", "A", 1, 4, OPERAND_NONE, FLOW_NEXT }, // af
+    { "ORA", "B", 1, 4, OPERAND_NONE, FLOW_NEXT }, // b0
+    { "ORA", "C", 1, 4, OPERAND_NONE, FLOW_NEXT }, // b1
+    { "ORA", "D", 1, 4, OPERAND_NONE, FLOW_NEXT }, // b2
+    { "ORA", "E", 1, 4, OPERAND_NONE, FLOW_NEXT }, // b3
+    { "ORA", "H", 1, 4, OPERAND_NONE, FLOW_NEXT }, // b4
+    { "ORA", "L", 1, 4, OPERAND_NONE, FLOW_NEXT }, // b5
+    { "ORA", "M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // b6
+    { "ORA", "A", 1, 4, OPERAND_NONE, FLOW_NEXT }, // b7
+    { "CMP", "B", 1, 4, OPERAND_NONE, FLOW_NEXT }, // b8
+    { "CMP", "C", 1, 4, OPERAND_NONE, FLOW_NEXT }, // b9
+    { "CMP", "D", 1, 4, OPERAND_NONE, FLOW_NEXT }, // ba
+    { "CMP", "E", 1, 4, OPERAND_NONE, FLOW_NEXT }, // bb
+    { "CMP", "H", 1, 4, OPERAND_NONE, FLOW_NEXT }, // bc
+    { "CMP", "L", 1, 4, OPERAND_NONE, FLOW_NEXT }, // bd
+    { "CMP", "M", 1, 7, OPERAND_NONE, FLOW_NEXT }, // be
+    { "CMP", "A", 1, 4, OPERAND_NONE, FLOW_NEXT }, // bf
+    { "RNZ", "", 1, 5, OPERAND_NONE, FLOW_CONDITIONAL_RETURN }, // c0
+    { "POP", "B", 1, 10, OPERAND_NONE, FLOW_NEXT }, // c1
+    { "JNZ", "", 3, 10, OPERAND_TARGET, FLOW_BRANCH }, // c2
+    { "JMP", "", 3, 10, OPERAND_TARGET, FLOW_JUMP }, // c3
+    { "CNZ", "", 3, 11, OPERAND_TARGET, FLOW_CALL }, // c4
+    { "PUSH", "B", 1, 11, OPERAND_NONE, FLOW_NEXT }, // c5
+    { "ADI", "", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // c6
+    { "RST", "0", 1, 11, OPERAND_NONE, FLOW_RESTART }, // c7
+    { "RZ", "", 1, 5, OPERAND_NONE, FLOW_CONDITIONAL_RETURN }, // c8
+    { "RET", "", 1, 10, OPERAND_NONE, FLOW_RETURN }, // c9
+    { "JZ", "", 3, 10, OPERAND_TARGET, FLOW_BRANCH }, // ca
+    { "JMP", "", 3, 10, OPERAND_TARGET, FLOW_JUMP }, // cb
+    { "CZ", "", 3, 11, OPERAND_TARGET, FLOW_CALL }, // cc
+    { "CALL", "", 3, 17, OPERAND_TARGET, FLOW_CALL }, // cd
+    { "ACI", "", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // ce
+    { "RST", "1", 1, 11, OPERAND_NONE, FLOW_RESTART }, // cf
+    { "RNC", "", 1, 5, OPERAND_NONE, FLOW_CONDITIONAL_RETURN }, // d0
+    { "POP", "D", 1, 10, OPERAND_NONE, FLOW_NEXT }, // d1
+    { "JNC", "", 3, 10, OPERAND_TARGET, FLOW_BRANCH }, // d2
+    { "OUT", "", 2, 10, OPERAND_BYTE, FLOW_NEXT }, // d3
+    { "CNC", "", 3, 11, OPERAND_TARGET, FLOW_CALL }, // d4
+    { "PUSH", "D", 1, 11, OPERAND_NONE, FLOW_NEXT }, // d5
+    { "SUI", "", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // d6
+    { "RST", "2", 1, 11, OPERAND_NONE, FLOW_RESTART }, // d7
+    { "RC", "", 1, 5, OPERAND_NONE, FLOW_CONDITIONAL_RETURN }, // d8
+    { "RET", "", 1, 10, OPERAND_NONE, FLOW_RETURN }, // d9
+    { "JC", "", 3, 10, OPERAND_TARGET, FLOW_BRANCH }, // da
+    { "IN", "", 2, 10, OPERAND_BYTE, FLOW_NEXT }, // db
+    { "CC", "", 3, 11, OPERAND_TARGET, FLOW_CALL }, // dc
+    { "CALL", "", 3, 17, OPERAND_TARGET, FLOW_CALL }, // dd
+    { "SBI", "", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // de
+    { "RST", "3", 1, 11, OPERAND_NONE, FLOW_RESTART }, // df
+    { "RPO", "", 1, 5, OPERAND_NONE, FLOW_CONDITIONAL_RETURN }, // e0
+    { "POP", "H", 1, 10, OPERAND_NONE, FLOW_NEXT }, // e1
+    { "JPO", "", 3, 10, OPERAND_TARGET, FLOW_BRANCH }, // e2
+    { "XTHL", "", 1, 18, OPERAND_NONE, FLOW_NEXT }, // e3
+    { "CPO", "", 3, 11, OPERAND_TARGET, FLOW_CALL }, // e4
+    { "PUSH", "H", 1, 11, OPERAND_NONE, FLOW_NEXT }, // e5
+    { "ANI", "", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // e6
+    { "RST", "4", 1, 11, OPERAND_NONE, FLOW_RESTART }, // e7
+    { "RPE", "", 1, 5, OPERAND_NONE, FLOW_CONDITIONAL_RETURN }, // e8
+    { "PCHL", "", 1, 5, OPERAND_NONE, FLOW_INDIRECT }, // e9
+    { "JPE", "", 3, 10, OPERAND_TARGET, FLOW_BRANCH }, // ea
+    { "XCHG", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // eb
+    { "CPE", "", 3, 11, OPERAND_TARGET, FLOW_CALL }, // ec
+    { "CALL", "", 3, 17, OPERAND_TARGET, FLOW_CALL }, // ed
+    { "XRI", "", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // ee
+    { "RST", "5", 1, 11, OPERAND_NONE, FLOW_RESTART }, // ef
+    { "RP", "", 1, 5, OPERAND_NONE, FLOW_CONDITIONAL_RETURN }, // f0
+    { "POP", "PSW", 1, 10, OPERAND_NONE, FLOW_NEXT }, // f1
+    { "JP", "", 3, 10, OPERAND_TARGET, FLOW_BRANCH }, // f2
+    { "DI", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // f3
+    { "CP", "", 3, 11, OPERAND_TARGET, FLOW_CALL }, // f4
+    { "PUSH", "PSW", 1, 11, OPERAND_NONE, FLOW_NEXT }, // f5
+    { "ORI", "", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // f6
+    { "RST", "6", 1, 11, OPERAND_NONE, FLOW_RESTART }, // f7
+    { "RM", "", 1, 5, OPERAND_NONE, FLOW_CONDITIONAL_RETURN }, // f8
+    { "SPHL", "", 1, 5, OPERAND_NONE, FLOW_NEXT }, // f9
+    { "JM", "", 3, 10, OPERAND_TARGET, FLOW_BRANCH }, // fa
+    { "EI", "", 1, 4, OPERAND_NONE, FLOW_NEXT }, // fb
+    { "CM", "", 3, 11, OPERAND_TARGET, FLOW_CALL }, // fc
+    { "CALL", "", 3, 17, OPERAND_TARGET, FLOW_CALL }, // fd
+    { "CPI", "", 2, 7, OPERAND_BYTE, FLOW_NEXT }, // fe
+    { "RST", "7", 1, 11, OPERAND_NONE, FLOW_RESTART }, // ff
+};
+
+// Columns of the table as flat arrays, for the dispatch loops
+template<size_t... Ops>
+constexpr std::array<uint8_t, 256> OpcodeCycles(std::index_sequence<Ops...>) { return {{ OPCODE_INFO[Ops].cycles... }}; }
+template<size_t... Ops>
+constexpr std::array<uint8_t, 256> OpcodeLengths(std::index_sequence<Ops...>) { return {{ OPCODE_INFO[Ops].length... }}; }
+constexpr std::array<uint8_t, 256> OPCODE_CYCLES = OpcodeCycles(std::make_index_sequence<256>());
+constexpr std::array<uint8_t, 256> OPCODE_LENGTHS = OpcodeLengths(std::make_index_sequence<256>());
+
+// True for instructions after which execution may not continue at the next
+// address: jumps, calls, returns, RST, PCHL and HLT
+constexpr bool EndsBasicBlock(uint8_t op) {
+    return OPCODE_INFO[op].flow != FLOW_NEXT;
+}
+
+#endif
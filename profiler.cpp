@@ -0,0 +1,148 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <string.h>
+#include <string>
+
+// Deeper than any real call chain; a guest that calls and never returns
+// stops growing the stack here
+static const size_t MAX_DEPTH = 256;
+
+Profiler::Profiler() : pcHits(0x10000) {
+    Clear();
+}
+
+void Profiler::Clear() {
+    memset(opcodeCounts, 0, sizeof(opcodeCounts));
+    memset(opcodeCycles, 0, sizeof(opcodeCycles));
+    std::fill(pcHits.begin(), pcHits.end(), 0);
+    root.function = 0;  // the reset vector
+    root.parent = nullptr;
+    root.calls = 1;
+    root.instructions = root.selfCycles = 0;
+    root.children.clear();
+    context = &root;
+    stack.clear();
+    currentPc = currentSp = nextPc = nextSp = 0;
+}
+
+void Profiler::Enter(uint16_t function, uint16_t returnAddress) {
+    if (stack.size() >= MAX_DEPTH) return;
+    std::unique_ptr<Context>& child = context->children[function];
+    if (!child) {
+        child.reset(new Context());
+        child->function = function;
+        child->parent = context;
+    }
+    child->calls++;
+    stack.push_back({child.get(), returnAddress});
+    context = child.get();
+}
+
+void Profiler::Leave(uint16_t returnAddress) {
+    // Unwind to the frame this returns from; a RET that matches no frame
+    // (a computed jump through the stack) leaves the stack alone
+    for (size_t depth = stack.size(); depth > 0; depth--) {
+        if (stack[depth - 1].returnAddress != returnAddress) continue;
+        context = stack[depth - 1].context->parent;
+        stack.resize(depth - 1);
+        return;
+    }
+}
+
+namespace {
+
+struct FunctionTotals {
+    uint64_t calls = 0;
+    uint64_t instructions = 0;
+    uint64_t selfCycles = 0;
+    uint64_t totalCycles = 0;
+};
+
+}
+
+void Profiler::WriteJson(FILE* out) const {
+    uint64_t instructions = 0, cycles = 0;
+    for (int op = 0; op < 256; op++) {
+        instructions += opcodeCounts[op];
+        cycles += opcodeCycles[op];
+    }
+    fprintf(out, "{\n  \"instructions\": %llu,\n  \"cycles\": %llu,\n", (unsigned long long)instructions, (unsigned long long)cycles);
+
+    fprintf(out, "  \"opcodes\": [");
+    const char *separator = "\n";
+    for (int op = 0; op < 256; op++) {
+        if (opcodeCounts[op] == 0) continue;
+        fprintf(out, "%s    {\"opcode\": %d, \"count\": %llu, \"cycles\": %llu}", separator, op,
+                (unsigned long long)opcodeCounts[op], (unsigned long long)opcodeCycles[op]);
+        separator = ",\n";
+    }
+    fprintf(out, "\n  ],\n  \"pcs\": [");
+    separator = "\n";
+    for (int pc = 0; pc < 0x10000; pc++) {
+        if (pcHits[pc] == 0) continue;
+        fprintf(out, "%s    {\"pc\": %d, \"hits\": %llu}", separator, pc, (unsigned long long)pcHits[pc]);
+        separator = ",\n";
+    }
+
+    // Fold the calling-context tree into per-function totals and caller ->
+    // callee edges. Inclusive cycles of a recursive function are counted
+    // at its outermost activation only.
+    std::map<uint16_t, FunctionTotals> functions;
+    std::map<std::pair<uint16_t, uint16_t>, uint64_t> edges;
+    std::vector<uint16_t> path;
+    struct Walk {
+        static uint64_t Visit(const Context& node, std::vector<uint16_t>& path, std::map<uint16_t, FunctionTotals>& functions,
+                              std::map<std::pair<uint16_t, uint16_t>, uint64_t>& edges) {
+            uint64_t total = node.selfCycles;
+            path.push_back(node.function);
+            for (const auto& child : node.children) {
+                edges[std::make_pair(node.function, child.first)] += child.second->calls;
+                total += Visit(*child.second, path, functions, edges);
+            }
+            path.pop_back();
+            FunctionTotals& totals = functions[node.function];
+            totals.calls += node.calls;
+            totals.instructions += node.instructions;
+            totals.selfCycles += node.selfCycles;
+            if (std::find(path.begin(), path.end(), node.function) == path.end()) totals.totalCycles += total;
+            return total;
+        }
+    };
+    Walk::Visit(root, path, functions, edges);
+
+    fprintf(out, "\n  ],\n  \"functions\": [");
+    separator = "\n";
+    for (const auto& function : functions) {
+        const FunctionTotals& totals = function.second;
+        fprintf(out, "%s    {\"address\": %d, \"calls\": %llu, \"instructions\": %llu, \"selfCycles\": %llu, \"totalCycles\": %llu}",
+                separator, function.first, (unsigned long long)totals.calls, (unsigned long long)totals.instructions,
+                (unsigned long long)totals.selfCycles, (unsigned long long)totals.totalCycles);
+        separator = ",\n";
+    }
+    fprintf(out, "\n  ],\n  \"calls\": [");
+    separator = "\n";
+    for (const auto& edge : edges) {
+        fprintf(out, "%s    {\"caller\": %d, \"callee\": %d, \"count\": %llu}", separator, edge.first.first,
+                edge.first.second, (unsigned long long)edge.second);
+        separator = ",\n";
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+void Profiler::WriteStacks(FILE* out) const {
+    struct Walk {
+        static void Visit(const Context& node, std::string& path, FILE* out) {
+            size_t length = path.size();
+            char name[8];
+            snprintf(name, sizeof(name), "$%04x", node.function);
+            if (!path.empty()) path += ';';
+            path += name;
+            if (node.selfCycles != 0) fprintf(out, "%s %llu\n", path.c_str(), (unsigned long long)node.selfCycles);
+            for (const auto& child : node.children) Visit(*child.second, path, out);
+            path.resize(length);
+        }
+    };
+    std::string path;
+    Walk::Visit(root, path, out);
+}
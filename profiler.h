@@ -0,0 +1,87 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Guest profile: executions and cycles per opcode, hits per address, and a
+// calling-context tree built from calls, returns and interrupts. Cycles are
+// charged to the guest routine on top of the call stack, so the tree gives
+// self and inclusive cycles for every call path.
+//
+// The emulator feeds it through a trace policy that only exists in profile
+// builds (-DEMULATOR8080_PROFILE, 'make profile'); other builds contain no
+// counters at all. Native JIT blocks cannot be observed, so profiling runs
+// the JIT backend as the block cache.
+class Profiler {
+    public:
+        Profiler();
+        void Clear();
+
+        // Hooks around every instruction
+        void BeforeInstruction(uint16_t pc, uint16_t sp, uint8_t op, uint64_t cycles) {
+            // The pc moving anywhere but where the last instruction left it,
+            // with a return address pushed, is an interrupt being taken
+            if (pc != nextPc && sp == (uint16_t)(nextSp - 2)) Enter(pc, nextPc);
+            currentPc = pc;
+            currentSp = sp;
+            currentOp = op;
+            startCycles = cycles;
+        }
+        void AfterInstruction(uint16_t pc, uint16_t sp, uint64_t cycles) {
+            uint64_t spent = cycles - startCycles;
+            opcodeCounts[currentOp]++;
+            opcodeCycles[currentOp] += spent;
+            pcHits[currentPc]++;
+            context->selfCycles += spent;
+            context->instructions++;
+            if (IsCall(currentOp) && sp == (uint16_t)(currentSp - 2)) Enter(pc, currentPc + (IsRestart(currentOp) ? 1 : 3));
+            else if (IsReturn(currentOp) && sp == (uint16_t)(currentSp + 2)) Leave(pc);
+            nextPc = pc;
+            nextSp = sp;
+        }
+
+        // {"opcodes": [...], "pcs": [...], "functions": [...], "calls": [...]}
+        void WriteJson(FILE* out) const;
+        // One 'root;$0100;$0a20 cycles' line per call path, the collapsed
+        // stack format flame graph tools read
+        void WriteStacks(FILE* out) const;
+
+    private:
+        // One node per distinct call path
+        struct Context {
+            uint16_t function;      // entry address
+            Context *parent;
+            uint64_t calls = 0;
+            uint64_t instructions = 0;
+            uint64_t selfCycles = 0;
+            std::map<uint16_t, std::unique_ptr<Context>> children;
+        };
+        struct Frame {
+            Context *context;
+            uint16_t returnAddress;
+        };
+
+        uint64_t opcodeCounts[256];
+        uint64_t opcodeCycles[256];
+        std::vector<uint64_t> pcHits;   // 64K entries
+        Context root;
+        Context *context;
+        std::vector<Frame> stack;
+
+        uint16_t currentPc = 0, currentSp = 0, nextPc = 0, nextSp = 0;
+        uint8_t currentOp = 0;
+        uint64_t startCycles = 0;
+
+        // CALL, its undocumented aliases, conditional calls and RST
+        static bool IsCall(uint8_t op) { return op == 0xcd || op == 0xdd || op == 0xed || op == 0xfd || (op & 0xc7) == 0xc4 || IsRestart(op); }
+        static bool IsRestart(uint8_t op) { return (op & 0xc7) == 0xc7; }
+        static bool IsReturn(uint8_t op) { return op == 0xc9 || op == 0xd9 || (op & 0xc7) == 0xc0; }
+        void Enter(uint16_t function, uint16_t returnAddress);
+        void Leave(uint16_t returnAddress);
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "renderer.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RENDERER_HAS_SSE2 1
+#include <immintrin.h>
+#endif
+
+// Pixels for bit positions 0-7 of a video byte land on rows 255-0 counting
+// from the start of the line; this is the row for the first bit of a byte
+static inline int Row(int byte, int bit) {
+    return Renderer::HEIGHT - 1 - (byte * 8 + bit);
+}
+
+static void RenderScalar(const uint8_t* vram, const VideoDirtyMap& dirty, uint32_t* pixels, int stride) {
+    for (int column = 0; column < Renderer::WIDTH; column++) {
+        if (!dirty.Test(column)) continue;
+        const uint8_t *line = vram + column * VideoDirtyMap::LINE_BYTES;
+        for (int byte = 0; byte < VideoDirtyMap::LINE_BYTES; byte++) {
+            uint8_t value = line[byte];
+            for (int bit = 0; bit < 8; bit++)
+                pixels[Row(byte, bit) * stride + column] = (value >> bit) & 1 ? Renderer::PIXEL_ON : Renderer::PIXEL_OFF;
+        }
+    }
+}
+
+#ifdef RENDERER_HAS_SSE2
+
+// 16 lines at a time: gather the same byte of each line into one vector,
+// then every movemask picks the top bit of all 16 (one pixel row, 16
+// columns wide) and the add shifts the next bit up
+static void RenderSse2(const uint8_t* vram, const VideoDirtyMap& dirty, uint32_t* pixels, int stride) {
+    const __m128i on = _mm_set1_epi32(Renderer::PIXEL_ON);
+    const __m128i off = _mm_set1_epi32(Renderer::PIXEL_OFF);
+    const __m128i lanes = _mm_set_epi32(8, 4, 2, 1);
+    for (int column = 0; column < Renderer::WIDTH; column += 16) {
+        if (!dirty.Any(column, 16)) continue;
+        const uint8_t *lines = vram + column * VideoDirtyMap::LINE_BYTES;
+        for (int byte = 0; byte < VideoDirtyMap::LINE_BYTES; byte++) {
+            alignas(16) uint8_t gathered[16];
+            for (int i = 0; i < 16; i++) gathered[i] = lines[i * VideoDirtyMap::LINE_BYTES + byte];
+            __m128i bits = _mm_load_si128((const __m128i *)gathered);
+            for (int bit = 7; bit >= 0; bit--) {
+                uint32_t mask = _mm_movemask_epi8(bits);
+                bits = _mm_add_epi8(bits, bits);
+                __m128i *out = (__m128i *)&pixels[Row(byte, bit) * stride + column];
+                for (int quad = 0; quad < 4; quad++) {
+                    __m128i select = _mm_and_si128(_mm_set1_epi32(mask >> (quad * 4)), lanes);
+                    select = _mm_cmpeq_epi32(select, lanes);
+                    _mm_storeu_si128(out + quad, _mm_or_si128(_mm_and_si128(select, on), _mm_andnot_si128(select, off)));
+                }
+            }
+        }
+    }
+}
+
+// Same transpose 32 lines wide; 224 lines divide evenly into 7 groups
+__attribute__((target("avx2")))
+static void RenderAvx2(const uint8_t* vram, const VideoDirtyMap& dirty, uint32_t* pixels, int stride) {
+    const __m256i on = _mm256_set1_epi32(Renderer::PIXEL_ON);
+    const __m256i off = _mm256_set1_epi32(Renderer::PIXEL_OFF);
+    const __m256i lanes = _mm256_set_epi32(128, 64, 32, 16, 8, 4, 2, 1);
+    for (int column = 0; column < Renderer::WIDTH; column += 32) {
+        if (!dirty.Any(column, 32)) continue;
+        const uint8_t *lines = vram + column * VideoDirtyMap::LINE_BYTES;
+        for (int byte = 0; byte < VideoDirtyMap::LINE_BYTES; byte++) {
+            alignas(32) uint8_t gathered[32];
+            for (int i = 0; i < 32; i++) gathered[i] = lines[i * VideoDirtyMap::LINE_BYTES + byte];
+            __m256i bits = _mm256_load_si256((const __m256i *)gathered);
+            for (int bit = 7; bit >= 0; bit--) {
+                uint32_t mask = _mm256_movemask_epi8(bits);
+                bits = _mm256_add_epi8(bits, bits);
+                __m256i *out = (__m256i *)&pixels[Row(byte, bit) * stride + column];
+                for (int octet = 0; octet < 4; octet++) {
+                    __m256i select = _mm256_and_si256(_mm256_set1_epi32(mask >> (octet * 8)), lanes);
+                    select = _mm256_cmpeq_epi32(select, lanes);
+                    _mm256_storeu_si256(out + octet, _mm256_blendv_epi8(off, on, select));
+                }
+            }
+        }
+    }
+}
+
+#endif
+
+const uint32_t Renderer::PIXEL_ON;
+const uint32_t Renderer::PIXEL_OFF;
+
+Renderer::Renderer() : frame(WIDTH * HEIGHT, PIXEL_OFF) {
+    SetPath(PATH_AVX2);
+}
+
+Renderer::Path Renderer::SetPath(Path selected) {
+#ifdef RENDERER_HAS_SSE2
+    if (selected == PATH_AVX2 && !__builtin_cpu_supports("avx2")) selected = PATH_SSE2;
+#else
+    selected = PATH_SCALAR;
+#endif
+    path = selected;
+    return path;
+}
+
+void Renderer::Render(const uint8_t* memory) {
+    VideoDirtyMap all;
+    all.MarkAll();
+    Render(memory, all);
+}
+
+void Renderer::Render(const uint8_t* memory, const VideoDirtyMap& dirty, uint32_t* pixels, int stride) {
+    dirty.Span(updatedFirst, updatedCount);
+    if (updatedCount == 0) return;
+
+    const uint8_t *vram = memory + VideoDirtyMap::START;
+#ifdef RENDERER_HAS_SSE2
+    if (path == PATH_AVX2) { RenderAvx2(vram, dirty, pixels, stride); return; }
+    if (path == PATH_SSE2) { RenderSse2(vram, dirty, pixels, stride); return; }
+#endif
+    RenderScalar(vram, dirty, pixels, stride);
+}
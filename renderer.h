@@ -0,0 +1,60 @@
+#ifndef _RENDERER_H_
+#define _RENDERER_H_
+
+#include <stdint.h>
+#include <vector>
+#include "videoram.h"
+
+// Converts the Space Invaders 1 bit per pixel video RAM into 32 bit ARGB
+// pixels, rotated the way the monitor sits in the cabinet.
+//
+// Video RAM is 0x2400-0x3fff: 224 lines of 32 bytes, each line a column of
+// the picture read bottom to top with the least significant bit first. The
+// picture is 224 pixels wide and 256 high, so a byte covers 8 rows of one
+// column. The SIMD paths transpose 16 (SSE2) or 32 (AVX2) lines at a time
+// with movemask, so each bit position becomes a run of horizontally
+// adjacent pixels, and expand those masks into pixels with compares.
+// Given the emulator's dirty map only the lines written since the last
+// render are converted (whole 16 or 32 line groups on the SIMD paths), and
+// Updated() reports the column span a texture upload needs. Without a
+// display the frame stays in Frame(); Window uploads the same buffer into
+// its texture.
+class Renderer {
+    public:
+        static const int WIDTH = VideoDirtyMap::LINES;
+        static const int HEIGHT = VideoDirtyMap::LINE_BYTES * 8;
+
+        static const uint32_t PIXEL_ON = 0xffffffff;
+        static const uint32_t PIXEL_OFF = 0xff000000;
+
+        enum Path { PATH_SCALAR, PATH_SSE2, PATH_AVX2 };
+
+        // Picks the widest path the host supports
+        Renderer();
+
+        // Renders the video RAM of a 64 KiB memory image into the frame buffer
+        void Render(const uint8_t* memory);
+        // Renders only the lines marked in dirty; the rest of the frame
+        // buffer must already match memory
+        void Render(const uint8_t* memory, const VideoDirtyMap& dirty) { Render(memory, dirty, frame.data(), WIDTH); }
+        // Renders into caller-owned pixels, stride pixels apart per row
+        void Render(const uint8_t* memory, const VideoDirtyMap& dirty, uint32_t* pixels, int stride);
+
+        const uint32_t* Frame() const { return frame.data(); }
+        // Columns changed by the last render: count columns from first, 0 if
+        // nothing changed
+        void Updated(int& first, int& count) const { first = updatedFirst; count = updatedCount; }
+
+        // Selecting a path the host lacks falls back to the next narrower
+        // one; the path actually selected is returned
+        Path SetPath(Path selected);
+        Path CurrentPath() const { return path; }
+
+    private:
+        std::vector<uint32_t> frame;
+        Path path;
+        int updatedFirst = 0;
+        int updatedCount = 0;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "rewind.h"
+
+#include <string.h>
+
+RewindBuffer::RewindBuffer(Emulator8080& emulator, size_t budget) : emulator(emulator), budget(budget) {}
+
+void RewindBuffer::Clear() {
+    snapshots.clear();
+    bytes = 0;
+}
+
+// Record layout: the page number, then (skip, count, count XOR bytes) runs
+// with skip counted from the end of the previous run, ended by (0, 0)
+void RewindBuffer::EncodePage(uint8_t page, std::vector<uint8_t>& out) {
+    uint8_t *old = &shadow[page * Emulator8080::PAGE_SIZE];
+    const uint8_t *now = emulator.Memory() + page * Emulator8080::PAGE_SIZE;
+    size_t start = out.size();
+    out.push_back(page);
+    int offset = 0, last = 0;
+    while (offset < Emulator8080::PAGE_SIZE) {
+        if (old[offset] == now[offset]) {
+            offset++;
+            continue;
+        }
+        int count = 0;
+        while (offset + count < Emulator8080::PAGE_SIZE && count < 255 && old[offset + count] != now[offset + count]) count++;
+        out.push_back(offset - last);
+        out.push_back(count);
+        for (int i = 0; i < count; i++) out.push_back(old[offset + i] ^ now[offset + i]);
+        offset += count;
+        last = offset;
+    }
+    if (out.size() == start + 1) {
+        out.pop_back(); // written with the same values
+        return;
+    }
+    out.push_back(0);
+    out.push_back(0);
+    memcpy(old, now, Emulator8080::PAGE_SIZE);
+}
+
+void RewindBuffer::ApplyUndo(const std::vector<uint8_t>& undo, uint64_t touched[Emulator8080::PAGES / 64]) {
+    const uint8_t *p = undo.data();
+    const uint8_t *end = p + undo.size();
+    while (p < end) {
+        uint8_t page = *p++;
+        touched[page >> 6] |= 1ull << (page & 63);
+        uint8_t *data = &shadow[page * Emulator8080::PAGE_SIZE];
+        int offset = 0;
+        while (true) {
+            uint8_t skip = *p++;
+            uint8_t count = *p++;
+            if (skip == 0 && count == 0) break;
+            offset += skip;
+            for (int i = 0; i < count; i++) data[offset + i] ^= *p++;
+            offset += count;
+        }
+    }
+}
+
+void RewindBuffer::Capture() {
+    uint64_t written[Emulator8080::PAGES / 64];
+    emulator.TakeWrittenPages(written);
+    if (snapshots.empty()) {
+        const uint8_t *memory = emulator.Memory();
+        shadow.assign(memory, memory + RomSet::MEMORY_SIZE);
+    } else {
+        Snapshot& previous = snapshots.back();
+        bytes -= Cost(previous);
+        for (int page = 0; page < Emulator8080::PAGES; page++) {
+            if (written[page >> 6] & (1ull << (page & 63))) EncodePage(page, previous.undo);
+        }
+        previous.undo.shrink_to_fit();
+        bytes += Cost(previous);
+    }
+
+    snapshots.emplace_back();
+    SaveState::PutMachine(emulator.CaptureMachine(), snapshots.back().machine);
+    bytes += Cost(snapshots.back());
+    while (bytes > budget && snapshots.size() > 1) {
+        bytes -= Cost(snapshots.front());
+        snapshots.pop_front();
+    }
+}
+
+size_t RewindBuffer::Rewind(size_t frames) {
+    if (snapshots.empty()) return 0;
+    if (frames > snapshots.size() - 1) frames = snapshots.size() - 1;
+
+    // The shadow holds the latest capture; undo back from there
+    uint64_t touched[Emulator8080::PAGES / 64];
+    emulator.TakeWrittenPages(touched);
+    for (size_t i = 0; i < frames; i++) {
+        bytes -= Cost(snapshots.back());
+        snapshots.pop_back();
+        ApplyUndo(snapshots.back().undo, touched);
+    }
+    bytes -= Cost(snapshots.back());
+    snapshots.back().undo = std::vector<uint8_t>();
+    bytes += Cost(snapshots.back());
+
+    const uint8_t *memory = emulator.Memory();
+    for (int page = 0; page < Emulator8080::PAGES; page++) {
+        if (!(touched[page >> 6] & (1ull << (page & 63)))) continue;
+        const uint8_t *contents = &shadow[page * Emulator8080::PAGE_SIZE];
+        if (memcmp(memory + page * Emulator8080::PAGE_SIZE, contents, Emulator8080::PAGE_SIZE) != 0)
+            emulator.RestorePage(page, contents);
+    }
+    emulator.RestoreMachine(SaveState::GetMachine(snapshots.back().machine));
+    // The restores above are not new writes
+    emulator.TakeWrittenPages(touched);
+    return frames;
+}
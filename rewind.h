@@ -0,0 +1,56 @@
+#ifndef _REWIND_H_
+#define _REWIND_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <vector>
+#include "emulator8080.h"
+#include "savestate.h"
+
+// Per-frame rewind history. Capture records the machine state plus, for
+// each page written since the previous capture, the XOR of its old and new
+// contents with the unchanged runs squeezed out. Pages nobody writes (ROM
+// among them) are never stored, and a frame that moves one sprite costs a
+// few dozen bytes. A shadow copy of memory at the latest capture is what
+// the XOR is taken against.
+//
+// Rewinding applies those deltas newest first to get back to an earlier
+// capture, so going back a few seconds touches only a few KiB. History is
+// capped by a byte budget and the oldest frames are dropped first.
+class RewindBuffer {
+    public:
+        explicit RewindBuffer(Emulator8080& emulator, size_t budget = 4 << 20);
+
+        // Records the emulator's current state; call once per frame
+        void Capture();
+        // Returns the emulator to the capture frames before the latest one
+        // (0 just discards what ran since the latest capture) and forgets
+        // the captures after it. Returns how many frames it went back, which
+        // is less than asked when the history is shorter.
+        size_t Rewind(size_t frames);
+
+        size_t Frames() const { return snapshots.size(); }
+        size_t Bytes() const { return bytes; }
+        void Clear();
+
+    private:
+        struct Snapshot {
+            uint8_t machine[SaveState::MACHINE_BYTES];
+            // XOR runs taking memory from the next capture back to this one
+            std::vector<uint8_t> undo;
+        };
+
+        Emulator8080& emulator;
+        size_t budget;
+        size_t bytes = 0;
+        std::deque<Snapshot> snapshots;
+        std::vector<uint8_t> shadow;    // memory as of the latest capture
+
+        static size_t Cost(const Snapshot& snapshot) { return sizeof(Snapshot) + snapshot.undo.capacity(); }
+        void EncodePage(uint8_t page, std::vector<uint8_t>& out);
+        // XORs every run in undo into the shadow and marks the pages touched
+        void ApplyUndo(const std::vector<uint8_t>& undo, uint64_t touched[Emulator8080::PAGES / 64]);
+};
+
+#endif
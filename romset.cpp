@@ -0,0 +1,198 @@
+#include "romset.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// CRC-32 (IEEE 802.3, reflected) lookup table, built at compile time
+struct Crc32Table {
+    uint32_t value[256];
+    constexpr Crc32Table() : value() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            value[i] = c;
+        }
+    }
+};
+static constexpr Crc32Table CRC32_TABLE{};
+
+RomSet::~RomSet() {
+    if (image != nullptr) munmap(image, MEMORY_SIZE);
+    if (imageFd >= 0) close(imageFd);
+}
+
+bool RomSet::LoadManifest(const char* path) {
+    FILE *manifest = fopen(path, "r");
+    if (manifest == NULL) {
+        printf("error: Couldn't open manifest %s\n", path);
+        return false;
+    }
+    const char *slash = strrchr(path, '/');
+    baseDirectory = slash ? std::string(path, slash - path + 1) : std::string();
+
+    char line[512];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), manifest)) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        char file[256], access[8], crc[16];
+        unsigned int address, size;
+        int fields = sscanf(line, "%255s %x %x %7s %15s", file, &address, &size, access, crc);
+        if (fields <= 0) continue; // blank or comment-only line
+        if (strcmp(file, "mirror") == 0) {
+            unsigned int source, sourceSize;
+            if (sscanf(line, " mirror %x %x %x %x", &address, &size, &source, &sourceSize) != 4 ||
+                address > 0xffff || source > 0xffff || !AddMirror({(uint16_t)address, size, (uint16_t)source, sourceSize})) {
+                printf("error: %s:%d: expected 'mirror address size source source-size' in whole pages\n", path, lineNumber);
+                fclose(manifest);
+                return false;
+            }
+            continue;
+        }
+        if (fields < 4 || (strcmp(access, "ro") != 0 && strcmp(access, "rw") != 0)) {
+            printf("error: %s:%d: expected 'file address size ro|rw [crc32]'\n", path, lineNumber);
+            fclose(manifest);
+            return false;
+        }
+
+        Image entry;
+        entry.file = baseDirectory + file;
+        entry.address = address;
+        entry.size = size;
+        entry.readOnly = strcmp(access, "ro") == 0;
+        entry.verifyChecksum = fields == 5 && strcmp(crc, "-") != 0;
+        entry.checksum = entry.verifyChecksum ? strtoul(crc, NULL, 16) : 0;
+        if (address > 0xffff || !AddImage(entry)) {
+            printf("error: %s:%d: image %s does not fit at $%04x\n", path, lineNumber, file, address);
+            fclose(manifest);
+            return false;
+        }
+    }
+    fclose(manifest);
+    return Build();
+}
+
+bool RomSet::AddImage(const Image& entry) {
+    if (entry.size == 0 || entry.address + entry.size > MEMORY_SIZE) return false;
+    if (!entry.data.empty() && entry.data.size() != entry.size) return false;
+    for (const Image& other : images) {
+        if (entry.address < other.address + other.size && other.address < entry.address + entry.size) return false;
+    }
+    images.push_back(entry);
+    return true;
+}
+
+bool RomSet::AddMirror(const Mirror& mirror) {
+    const uint32_t PAGE = 0x100;
+    if (mirror.size == 0 || mirror.sourceSize == 0 || mirror.address + mirror.size > MEMORY_SIZE ||
+        mirror.source + mirror.sourceSize > MEMORY_SIZE) return false;
+    if ((mirror.address | mirror.size | mirror.source | mirror.sourceSize) % PAGE != 0) return false;
+    mirrors.push_back(mirror);
+    return true;
+}
+
+bool RomSet::CopyFileInto(const Image& entry, uint8_t* destination) {
+    int fd = open(entry.file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        printf("error: Couldn't open %s\n", entry.file.c_str());
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (uint64_t)info.st_size != entry.size) {
+        printf("error: %s is %lld bytes, manifest expects %u\n", entry.file.c_str(), (long long)info.st_size, entry.size);
+        close(fd);
+        return false;
+    }
+    void *file = mmap(nullptr, entry.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED) {
+        printf("error: Couldn't map %s\n", entry.file.c_str());
+        return false;
+    }
+    bool ok = true;
+    if (entry.verifyChecksum) {
+        uint32_t crc = Crc32((const uint8_t *)file, entry.size);
+        if (crc != entry.checksum) {
+            printf("error: %s has crc32 %08x, manifest expects %08x\n", entry.file.c_str(), crc, entry.checksum);
+            ok = false;
+        }
+    }
+    if (ok) memcpy(destination, file, entry.size);
+    munmap(file, entry.size);
+    return ok;
+}
+
+static int CreateSharedMemory(size_t size) {
+    int fd;
+#ifdef __linux__
+    fd = memfd_create("emulator8080-rom", 0);
+#else
+    char name[64];
+    snprintf(name, sizeof(name), "/emulator8080-rom-%d-%p", getpid(), (void *)&name);
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) shm_unlink(name);
+#endif
+    if (fd >= 0 && ftruncate(fd, size) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool RomSet::Build() {
+    if (image != nullptr) return true;
+    imageFd = CreateSharedMemory(MEMORY_SIZE);
+    if (imageFd < 0) {
+        printf("error: Couldn't create shared memory for the ROM image\n");
+        return false;
+    }
+    void *shared = mmap(nullptr, MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, imageFd, 0);
+    if (shared == MAP_FAILED) {
+        printf("error: Couldn't map the ROM image\n");
+        return false;
+    }
+    for (const Image& entry : images) {
+        if (!entry.data.empty()) {
+            memcpy((uint8_t *)shared + entry.address, entry.data.data(), entry.size);
+            continue;
+        }
+        if (!CopyFileInto(entry, (uint8_t *)shared + entry.address)) {
+            munmap(shared, MEMORY_SIZE);
+            return false;
+        }
+    }
+    // The pristine image is never written again
+    mprotect(shared, MEMORY_SIZE, PROT_READ);
+    image = (uint8_t *)shared;
+    return true;
+}
+
+uint8_t* RomSet::MapMemory() const {
+    if (image == nullptr) return nullptr;
+    void *memory = mmap(nullptr, MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE, imageFd, 0);
+    return memory == MAP_FAILED ? nullptr : (uint8_t *)memory;
+}
+
+void RomSet::UnmapMemory(uint8_t* memory) {
+    if (memory != nullptr) munmap(memory, MEMORY_SIZE);
+}
+
+bool RomSet::IsReadOnly(uint16_t address) const {
+    for (const Image& entry : images) {
+        if (entry.readOnly && address >= entry.address && address < entry.address + entry.size) return true;
+    }
+    return false;
+}
+
+uint32_t RomSet::Crc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; i++) crc = CRC32_TABLE.value[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffff;
+}
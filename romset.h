@@ -0,0 +1,86 @@
+#ifndef _ROMSET_H_
+#define _ROMSET_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// A set of ROM images described by a manifest and assembled once into a
+// shared 64 KiB memory image. Every emulator instance maps that image
+// copy-on-write, so ROM pages are shared by all instances and only the RAM
+// pages an instance actually writes get a private copy.
+//
+// Manifest format, one image per line ('#' starts a comment):
+//
+//     # file        address  size    access  crc32
+//     invaders.h    0x0000   0x0800  ro      734f5ad8
+//
+// access is 'ro' or 'rw'; crc32 may be '-' to skip verification. File paths
+// are relative to the manifest's directory. Images added with AddImage may
+// carry their contents in data instead of naming a file. Memory no image
+// covers is RAM.
+//
+// A 'mirror' line makes the address decoder ignore some address lines: the
+// pages of a range read and write the pages of a source range instead,
+// repeating it if the range is larger. Both are whole 256 byte pages.
+//
+//     mirror  address  size    source  source-size
+//     mirror  0x4000   0xc000  0x2000  0x2000
+class RomSet {
+    public:
+        static const uint32_t MEMORY_SIZE = 0x10000;
+
+        struct Image {
+            std::string file;
+            uint16_t    address;
+            uint32_t    size;
+            bool        readOnly;
+            bool        verifyChecksum;
+            uint32_t    checksum; // CRC-32 of the whole image
+            std::vector<uint8_t> data; // contents when not loaded from file
+        };
+
+        struct Mirror {
+            uint16_t    address;
+            uint32_t    size;
+            uint16_t    source;
+            uint32_t    sourceSize;
+        };
+
+        RomSet() {}
+        ~RomSet();
+        RomSet(const RomSet&) = delete;
+        RomSet& operator=(const RomSet&) = delete;
+
+        // Parses the manifest and builds the shared image. Prints the reason
+        // and returns false on any malformed line, missing file, size or
+        // checksum mismatch, or image that does not fit in 64 KiB.
+        bool LoadManifest(const char* path);
+        bool AddImage(const Image& image);
+        bool AddMirror(const Mirror& mirror);
+        bool Build();
+
+        // Maps a private copy-on-write view of the shared image for one
+        // instance. Returns nullptr if the set has not been built.
+        uint8_t* MapMemory() const;
+        static void UnmapMemory(uint8_t* memory);
+
+        // Read-only view of the pristine image, e.g. for resetting an instance
+        const uint8_t* Pristine() const { return image; }
+        const std::vector<Image>& Images() const { return images; }
+        const std::vector<Mirror>& Mirrors() const { return mirrors; }
+        bool IsReadOnly(uint16_t address) const;
+
+        static uint32_t Crc32(const uint8_t* data, size_t size);
+
+    private:
+        std::vector<Image> images;
+        std::vector<Mirror> mirrors;
+        std::string baseDirectory;
+        int imageFd = -1;
+        uint8_t* image = nullptr;
+
+        bool CopyFileInto(const Image& entry, uint8_t* destination);
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "savestate.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char MAGIC[8] = { '8', '0', '8', '0', 'S', 'A', 'V', 'E' };
+static const size_t HEADER_BYTES = sizeof(MAGIC) + 4 + 4;
+static const size_t BITMAP_BYTES = Emulator8080::PAGES / 8;
+
+static void Put16(uint8_t*& out, uint16_t value) { out[0] = value; out[1] = value >> 8; out += 2; }
+static void Put32(uint8_t*& out, uint32_t value) { Put16(out, value); Put16(out, value >> 16); }
+static void Put64(uint8_t*& out, uint64_t value) { Put32(out, value); Put32(out, value >> 32); }
+static uint16_t Get16(const uint8_t*& in) { uint16_t value = in[0] | (in[1] << 8); in += 2; return value; }
+static uint32_t Get32(const uint8_t*& in) { uint32_t low = Get16(in); return low | ((uint32_t)Get16(in) << 16); }
+static uint64_t Get64(const uint8_t*& in) { uint64_t low = Get32(in); return low | ((uint64_t)Get32(in) << 32); }
+
+void SaveState::PutMachine(const Emulator8080::MachineState& machine, uint8_t* out) {
+    const Emulator8080::Registers& r = machine.registers;
+    const uint8_t bytes[] = { r.a, r.b, r.c, r.d, r.e, r.h, r.l, r.flags, r.int_enable, r.halted, machine.shiftOffset };
+    memcpy(out, bytes, sizeof(bytes));
+    out += sizeof(bytes);
+    Put16(out, r.sp);
+    Put16(out, r.pc);
+    Put16(out, machine.shiftValue);
+    Put64(out, r.cycles);
+    Put64(out, r.instructions);
+}
+
+Emulator8080::MachineState SaveState::GetMachine(const uint8_t* in) {
+    Emulator8080::MachineState machine;
+    Emulator8080::Registers& r = machine.registers;
+    r.a = in[0]; r.b = in[1]; r.c = in[2]; r.d = in[3]; r.e = in[4]; r.h = in[5]; r.l = in[6];
+    r.flags = in[7];
+    r.int_enable = in[8];
+    r.halted = in[9];
+    machine.shiftOffset = in[10];
+    in += 11;
+    r.sp = Get16(in);
+    r.pc = Get16(in);
+    machine.shiftValue = Get16(in);
+    r.cycles = Get64(in);
+    r.instructions = Get64(in);
+    return machine;
+}
+
+uint32_t SaveState::RomChecksum(const Emulator8080& emulator) {
+    std::vector<uint8_t> rom;
+    for (int page = 0; page < Emulator8080::PAGES; page++) {
+        if (!emulator.IsRomPage(page)) continue;
+        const uint8_t *data = emulator.Pristine() + page * Emulator8080::PAGE_SIZE;
+        rom.insert(rom.end(), data, data + Emulator8080::PAGE_SIZE);
+    }
+    return RomSet::Crc32(rom.data(), rom.size());
+}
+
+void SaveState::Save(const Emulator8080& emulator, std::vector<uint8_t>& out) {
+    const uint8_t *memory = emulator.Memory();
+    const uint8_t *pristine = emulator.Pristine();
+    uint8_t bitmap[BITMAP_BYTES] = {};
+    int pages = 0;
+    for (int page = 0; page < Emulator8080::PAGES; page++) {
+        size_t offset = page * Emulator8080::PAGE_SIZE;
+        if (memcmp(memory + offset, pristine + offset, Emulator8080::PAGE_SIZE) == 0) continue;
+        bitmap[page >> 3] |= 1 << (page & 7);
+        pages++;
+    }
+
+    out.resize(HEADER_BYTES + MACHINE_BYTES + 256 + BITMAP_BYTES + pages * Emulator8080::PAGE_SIZE);
+    uint8_t *p = out.data();
+    memcpy(p, MAGIC, sizeof(MAGIC));
+    p += sizeof(MAGIC);
+    Put32(p, VERSION);
+    Put32(p, RomChecksum(emulator));
+    PutMachine(emulator.CaptureMachine(), p);
+    p += MACHINE_BYTES;
+    const InputLatch& inputs = emulator.Io().Get<InputLatch>();
+    for (int port = 0; port < 256; port++) *p++ = inputs.Get(port);
+    memcpy(p, bitmap, BITMAP_BYTES);
+    p += BITMAP_BYTES;
+    for (int page = 0; page < Emulator8080::PAGES; page++) {
+        if (!(bitmap[page >> 3] & (1 << (page & 7)))) continue;
+        memcpy(p, memory + page * Emulator8080::PAGE_SIZE, Emulator8080::PAGE_SIZE);
+        p += Emulator8080::PAGE_SIZE;
+    }
+}
+
+bool SaveState::Load(Emulator8080& emulator, const uint8_t* data, size_t size) {
+    const size_t fixed = HEADER_BYTES + MACHINE_BYTES + 256 + BITMAP_BYTES;
+    if (size < fixed || memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+        printf("error: not a save-state\n");
+        return false;
+    }
+    const uint8_t *p = data + sizeof(MAGIC);
+    uint32_t version = Get32(p);
+    uint32_t checksum = Get32(p);
+    if (version != VERSION) {
+        printf("error: save-state version %u, this build reads version %u\n", version, VERSION);
+        return false;
+    }
+    if (checksum != RomChecksum(emulator)) {
+        printf("error: save-state was made with different ROMs (crc32 %08x)\n", checksum);
+        return false;
+    }
+    const uint8_t *machine = p;
+    const uint8_t *inputs = machine + MACHINE_BYTES;
+    const uint8_t *bitmap = inputs + 256;
+    const uint8_t *pages = bitmap + BITMAP_BYTES;
+    size_t count = 0;
+    for (size_t i = 0; i < BITMAP_BYTES; i++) count += __builtin_popcount(bitmap[i]);
+    if (size != fixed + count * Emulator8080::PAGE_SIZE) {
+        printf("error: save-state is truncated or has trailing data\n");
+        return false;
+    }
+
+    // Pages missing from the state hold their pristine contents
+    const uint8_t *memory = emulator.Memory();
+    for (int page = 0; page < Emulator8080::PAGES; page++) {
+        size_t offset = page * Emulator8080::PAGE_SIZE;
+        const uint8_t *contents = emulator.Pristine() + offset;
+        if (bitmap[page >> 3] & (1 << (page & 7))) {
+            contents = pages;
+            pages += Emulator8080::PAGE_SIZE;
+        }
+        if (memcmp(memory + offset, contents, Emulator8080::PAGE_SIZE) != 0) emulator.RestorePage(page, contents);
+    }
+    emulator.RestoreMachine(GetMachine(machine));
+    for (int port = 0; port < 256; port++) emulator.Io().Get<InputLatch>().Set(port, inputs[port]);
+    return true;
+}
+
+bool SaveState::SaveFile(const Emulator8080& emulator, const char* path) {
+    std::vector<uint8_t> state;
+    Save(emulator, state);
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        printf("error: Couldn't create %s\n", path);
+        return false;
+    }
+    bool ok = fwrite(state.data(), 1, state.size(), file) == state.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok) printf("error: Couldn't write %s\n", path);
+    return ok;
+}
+
+bool SaveState::LoadFile(Emulator8080& emulator, const char* path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("error: Couldn't open %s\n", path);
+        return false;
+    }
+    std::vector<uint8_t> state;
+    uint8_t buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) state.insert(state.end(), buffer, buffer + read);
+    fclose(file);
+    return Load(emulator, state.data(), state.size());
+}
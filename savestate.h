@@ -0,0 +1,40 @@
+#ifndef _SAVESTATE_H_
+#define _SAVESTATE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "emulator8080.h"
+
+// Versioned save-states. A state holds the machine state (registers, flags,
+// interrupt and halt state, cycle and instruction counts, shift register),
+// the input latch and only the memory pages that differ from the ROM set's
+// pristine image, so a Space Invaders state is a few KiB. Every field is
+// stored little-endian at a fixed offset, independent of struct layout.
+//
+//     "8080SAVE"  u32 version  u32 crc32 of the ROM pages
+//     machine state  input ports[256]  page bitmap[32]  pages[n][256]
+//
+// Loading checks the magic, version and ROM checksum, so a state only loads
+// into the game it was saved from.
+class SaveState {
+    public:
+        static const uint32_t VERSION = 1;
+
+        static void Save(const Emulator8080& emulator, std::vector<uint8_t>& out);
+        // Prints the reason and leaves the emulator untouched on failure
+        static bool Load(Emulator8080& emulator, const uint8_t* data, size_t size);
+
+        static bool SaveFile(const Emulator8080& emulator, const char* path);
+        static bool LoadFile(Emulator8080& emulator, const char* path);
+
+        // Machine state in its serialized form, shared with the rewind buffer
+        static const size_t MACHINE_BYTES = 33;
+        static void PutMachine(const Emulator8080::MachineState& machine, uint8_t* out);
+        static Emulator8080::MachineState GetMachine(const uint8_t* in);
+
+    private:
+        static uint32_t RomChecksum(const Emulator8080& emulator);
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+// Events keyed on the emulated cycle counter. Pending events sit in a
+// min-heap on their deadline, so the emulator runs uninterrupted batches up
+// to NextDeadline() and only then dispatches what is due; nothing is polled
+// per instruction. Events with the same deadline fire in the order they
+// were scheduled.
+class EventScheduler {
+    public:
+        typedef std::function<void()> Callback;
+        static const uint64_t NO_DEADLINE = UINT64_MAX;
+
+        void Schedule(uint64_t cycle, Callback callback) {
+            SchedulePeriodic(cycle, 0, std::move(callback));
+        }
+        // Fires at cycle and then every period cycles after it. The next
+        // deadline is counted from the previous one, not from when the event
+        // was dispatched, so late dispatch does not drift.
+        void SchedulePeriodic(uint64_t cycle, uint64_t period, Callback callback) {
+            heap.push_back({cycle, period, sequence++, std::move(callback)});
+            std::push_heap(heap.begin(), heap.end(), Later);
+        }
+
+        uint64_t NextDeadline() const { return heap.empty() ? NO_DEADLINE : heap.front().deadline; }
+
+        // Fires every event whose deadline is at or before now
+        void Dispatch(uint64_t now) {
+            while (!heap.empty() && heap.front().deadline <= now) {
+                std::pop_heap(heap.begin(), heap.end(), Later);
+                Event event = std::move(heap.back());
+                heap.pop_back();
+                event.callback();
+                if (event.period != 0) {
+                    event.deadline += event.period;
+                    event.order = sequence++;
+                    heap.push_back(std::move(event));
+                    std::push_heap(heap.begin(), heap.end(), Later);
+                }
+            }
+        }
+
+        void Clear() { heap.clear(); }
+
+        // Moves periodic events to their first deadline after now, keeping
+        // their phase; used when the cycle counter is restored to another
+        // point in time. One-shot events are left where they are.
+        void Realign(uint64_t now) {
+            for (Event& event : heap) {
+                if (event.period == 0) continue;
+                uint64_t phase = (event.deadline % event.period + event.period - now % event.period) % event.period;
+                event.deadline = now + (phase == 0 ? event.period : phase);
+            }
+            std::make_heap(heap.begin(), heap.end(), Later);
+        }
+
+    private:
+        struct Event {
+            uint64_t    deadline;
+            uint64_t    period;     // 0 for one-shot events
+            uint64_t    order;      // breaks deadline ties in scheduling order
+            Callback    callback;
+        };
+        // Heap comparator: the earliest deadline ends up at the front
+        static bool Later(const Event& x, const Event& y) {
+            return x.deadline != y.deadline ? x.deadline > y.deadline : x.order > y.order;
+        }
+
+        std::vector<Event> heap;
+        uint64_t sequence = 0;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef _SPACEINVADERS_H_
+#define _SPACEINVADERS_H_
+
+#include <stdint.h>
+#include "emulator8080.h"
+
+// Space Invaders board timing. The 8080 runs at 2 MHz and the video at
+// 60 Hz with 262 scanlines per frame, 224 of them visible.
+const uint64_t CLOCK_RATE = 2000000;
+const uint64_t FRAMES_PER_SECOND = 60;
+const uint64_t CYCLES_PER_FRAME = CLOCK_RATE / FRAMES_PER_SECOND;
+const uint64_t SCANLINES_PER_FRAME = 262;
+const uint64_t MIDSCREEN_SCANLINE = 96;     // RST 1: the game redraws the top half
+const uint64_t VBLANK_SCANLINE = 224;       // RST 2: the game redraws the bottom half
+
+// Cycle offset into a frame at which the beam reaches a scanline
+constexpr uint64_t ScanlineCycle(uint64_t scanline) {
+    return CYCLES_PER_FRAME * scanline / SCANLINES_PER_FRAME;
+}
+
+// Raises the mid-screen and VBlank interrupts every frame, starting with the
+// frame that begins at the emulator's current cycle
+inline void ScheduleVideoInterrupts(Emulator8080& emulator) {
+    uint64_t frameStart = emulator.Cycles();
+    emulator.Events().SchedulePeriodic(frameStart + ScanlineCycle(MIDSCREEN_SCANLINE), CYCLES_PER_FRAME,
+                                       [&emulator] { emulator.Interrupt(1); });
+    emulator.Events().SchedulePeriodic(frameStart + ScanlineCycle(VBLANK_SCANLINE), CYCLES_PER_FRAME,
+                                       [&emulator] { emulator.Interrupt(2); });
+}
+
+#endif
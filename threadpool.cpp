@@ -0,0 +1,81 @@
+#include "threadpool.h"
+
+WorkStealingPool::WorkStealingPool(unsigned int threads) {
+    if (threads == 0) threads = 1;
+    for (unsigned int i = 0; i < threads; i++) queues.emplace_back(new Queue());
+    for (unsigned int i = 0; i < threads; i++) workers.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void WorkStealingPool::Submit(Job job) {
+    Queue& queue = *queues[nextQueue++ % queues.size()];
+    // Counted before it is queued, so a worker that takes it at once never
+    // takes the counts below zero
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        pending++;
+        queued++;
+    }
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.jobs.push_back(std::move(job));
+    }
+    workAvailable.notify_one();
+}
+
+void WorkStealingPool::Wait() {
+    std::unique_lock<std::mutex> guard(stateLock);
+    allDone.wait(guard, [this] { return pending == 0; });
+}
+
+bool WorkStealingPool::TakeJob(unsigned int self, Job& job) {
+    if (!TakeQueued(self, job)) return false;
+    std::lock_guard<std::mutex> guard(stateLock);
+    queued--;
+    return true;
+}
+
+bool WorkStealingPool::TakeQueued(unsigned int self, Job& job) {
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue& victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::WorkerLoop(unsigned int self) {
+    while (true) {
+        Job job;
+        if (TakeJob(self, job)) {
+            job();
+            std::lock_guard<std::mutex> guard(stateLock);
+            if (--pending == 0) allDone.notify_all();
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(stateLock);
+        workAvailable.wait(guard, [this] { return queued > 0 || stopping; });
+        if (stopping) return;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size work-stealing pool. Each worker owns a deque: it takes work
+// from the back of its own deque and, when that runs dry, steals from the
+// front of the others. Jobs are dealt round-robin on Submit, so uneven job
+// lengths even out through stealing rather than a shared queue.
+class WorkStealingPool {
+    public:
+        typedef std::function<void()> Job;
+
+        explicit WorkStealingPool(unsigned int threads = std::thread::hardware_concurrency());
+        ~WorkStealingPool();
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        void Submit(Job job);
+        // Blocks until every submitted job has finished
+        void Wait();
+        unsigned int Threads() const { return (unsigned int)workers.size(); }
+
+    private:
+        struct Queue {
+            std::mutex      lock;
+            std::deque<Job> jobs;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<unsigned int> nextQueue{0};
+
+        std::mutex              stateLock;
+        std::condition_variable workAvailable;
+        std::condition_variable allDone;
+        size_t                  pending = 0; // submitted but not finished
+        size_t                  queued = 0;  // submitted but not yet taken
+        bool                    stopping = false;
+
+        bool TakeJob(unsigned int self, Job& job);
+        bool TakeQueued(unsigned int self, Job& job);
+        void WorkerLoop(unsigned int self);
+};
+
+#endif
@@ -0,0 +1,83 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "disassembler8080.h"
+#include "tracewriter.h"
+
+// Offline reader for binary traces (main --trace, batch8080 --trace-dir):
+// prints one line per instruction with the cycle count, the registers and
+// flags before it ran, and its disassembly.
+//
+//     cycles        A  BC   DE   HL   SP   flags  I H  pc   instruction
+//     12345678      00 0000 2400 20c0 2400 SZ.A.P.C 1 0  0a1b MOV    M,A
+
+static void Usage() {
+    printf("usage: tracedump8080 [--skip records] [--count records] [--pc address] trace\n");
+}
+
+static void PrintFlags(uint8_t flags, char* out) {
+    const char names[] = "SZ.A.P.C";
+    for (int bit = 0; bit < 8; bit++) out[bit] = (flags & (0x80 >> bit)) && names[bit] != '.' ? names[bit] : '.';
+    out[8] = '\0';
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t skip = 0, count = UINT64_MAX;
+    long pcFilter = -1;
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--skip") == 0 && i + 1 < argc) skip = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) count = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--pc") == 0 && i + 1 < argc) pcFilter = strtol(argv[++i], NULL, 16) & 0xffff;
+        else if (argv[i][0] != '-' && path == NULL) path = argv[i];
+        else { Usage(); return 1; }
+    }
+    if (path == NULL) {
+        Usage();
+        return 1;
+    }
+
+    FILE *trace = fopen(path, "rb");
+    if (trace == NULL) {
+        printf("error: Couldn't open %s\n", path);
+        return 1;
+    }
+    uint8_t header[TraceWriter::HEADER_BYTES];
+    uint32_t fields[3];
+    if (fread(header, 1, sizeof(header), trace) != sizeof(header) || memcmp(header, "8080TRCE", 8) != 0) {
+        printf("error: %s is not a trace\n", path);
+        fclose(trace);
+        return 1;
+    }
+    memcpy(fields, header + 8, sizeof(fields));
+    if (fields[0] != TraceWriter::VERSION || fields[1] != sizeof(TraceRecord) || fields[2] != TraceWriter::ENDIAN_MARK) {
+        printf("error: %s is trace version %u with %u byte records, or from a host of the other byte order\n", path, fields[0], fields[1]);
+        fclose(trace);
+        return 1;
+    }
+    if (skip > 0 && fseeko(trace, (off_t)(skip * sizeof(TraceRecord)), SEEK_CUR) != 0) {
+        fclose(trace);
+        return 0;
+    }
+
+    static TraceRecord records[4096];
+    size_t read;
+    uint64_t printed = 0;
+    while (printed < count && (read = fread(records, sizeof(TraceRecord), 4096, trace)) > 0) {
+        for (size_t i = 0; i < read && printed < count; i++) {
+            const TraceRecord& r = records[i];
+            if (pcFilter >= 0 && r.pc != pcFilter) continue;
+            char flags[9];
+            PrintFlags(r.flags, flags);
+            printf("%-13llu %02x %02x%02x %02x%02x %02x%02x %04x %s %d %d  ", (unsigned long long)r.cycles, r.a, r.b, r.c,
+                   r.d, r.e, r.h, r.l, r.sp, flags, (r.status & TRACE_INTERRUPTS_ENABLED) != 0, (r.status & TRACE_HALTED) != 0);
+            char instruction[Disassembler::MAX_FORMATTED];
+            Disassembler::Format(Disassembler::DecodeBytes(r.opcode, r.pc), instruction, sizeof(instruction));
+            printf("%04x %s\n", r.pc, instruction);
+            printed++;
+        }
+    }
+    fclose(trace);
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "tracewriter.h"
+
+#include <string.h>
+
+static const char MAGIC[8] = { '8', '0', '8', '0', 'T', 'R', 'C', 'E' };
+
+TraceWriter::TraceWriter() : chunks(CHUNKS) {}
+
+bool TraceWriter::Open(const char* path) {
+    Close();
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        printf("error: Couldn't create %s\n", path);
+        return false;
+    }
+    uint8_t header[HEADER_BYTES];
+    uint32_t fields[] = { VERSION, sizeof(TraceRecord), ENDIAN_MARK };
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    memcpy(header + sizeof(MAGIC), fields, sizeof(fields));
+    fwrite(header, 1, sizeof(header), file);
+
+    for (std::vector<TraceRecord>& chunk : chunks) chunk.resize(CHUNK_RECORDS);
+    fill = head = tail = 0;
+    closing = failed = false;
+    writer = std::thread([this] { WriteChunks(); });
+    return true;
+}
+
+void TraceWriter::Publish() {
+    std::unique_lock<std::mutex> guard(lock);
+    counts[head % CHUNKS] = fill;
+    head++;
+    published.notify_one();
+    written.wait(guard, [this] { return head - tail < CHUNKS; });
+    fill = 0;
+}
+
+void TraceWriter::WriteChunks() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        published.wait(guard, [this] { return tail != head || closing; });
+        if (tail == head) break;
+        // Chunks between tail and head belong to this thread until tail moves
+        size_t index = tail % CHUNKS;
+        guard.unlock();
+        if (!failed && fwrite(chunks[index].data(), sizeof(TraceRecord), counts[index], file) != counts[index]) {
+            printf("error: Couldn't write the trace; the rest of it is dropped\n");
+            failed = true;
+        }
+        guard.lock();
+        tail++;
+        written.notify_one();
+    }
+}
+
+void TraceWriter::Close() {
+    if (file == NULL) return;
+    if (fill > 0) Publish();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        closing = true;
+    }
+    published.notify_one();
+    writer.join();
+    if (fclose(file) != 0 && !failed) printf("error: Couldn't finish writing the trace\n");
+    file = NULL;
+    // The chunks are large; give the memory back between traces
+    for (std::vector<TraceRecord>& chunk : chunks) std::vector<TraceRecord>().swap(chunk);
+}
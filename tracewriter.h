@@ -0,0 +1,81 @@
+#ifndef _TRACEWRITER_H_
+#define _TRACEWRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One executed instruction as the CPU saw it just before running it
+struct TraceRecord {
+    uint64_t    cycles;
+    uint16_t    pc;
+    uint16_t    sp;
+    uint8_t     opcode[3];  // instruction bytes, unused ones included
+    uint8_t     a, b, c, d, e, h, l;
+    uint8_t     flags;      // PSW layout
+    uint8_t     status;     // TRACE_INTERRUPTS_ENABLED | TRACE_HALTED
+};
+static_assert(sizeof(TraceRecord) == 24, "trace records are written as they are laid out in memory");
+
+const uint8_t TRACE_INTERRUPTS_ENABLED = 0x01;
+const uint8_t TRACE_HALTED = 0x02;
+
+// Binary execution trace. Records are filled in place in a ring of large
+// chunks and a background thread writes each chunk as it fills, so the
+// emulation thread never formats text or makes a system call per
+// instruction. When the writer falls a whole ring behind, the emulation
+// thread waits for it rather than drop records.
+//
+//     "8080TRCE"  u32 version  u32 record size  u32 0x01020304 in host order
+//     records...
+//
+// tracedump8080 turns a trace back into disassembly and registers.
+class TraceWriter {
+    public:
+        static const uint32_t VERSION = 1;
+        static const uint32_t ENDIAN_MARK = 0x01020304;
+        static const size_t HEADER_BYTES = 20;
+        static const size_t CHUNK_RECORDS = 1 << 16;   // 1.5 MiB
+        static const size_t CHUNKS = 16;
+
+        TraceWriter();
+        ~TraceWriter() { Close(); }
+        TraceWriter(const TraceWriter&) = delete;
+        TraceWriter& operator=(const TraceWriter&) = delete;
+
+        bool Open(const char* path);
+        // Writes out everything appended so far and closes the file
+        void Close();
+        bool IsOpen() const { return file != NULL; }
+
+        // The next record to fill; only the emulation thread calls this
+        TraceRecord& Append() {
+            if (fill == CHUNK_RECORDS) Publish();
+            return chunks[head % CHUNKS][fill++];
+        }
+
+    private:
+        FILE *file = NULL;
+        std::vector<std::vector<TraceRecord>> chunks;
+        size_t counts[CHUNKS];      // records in each published chunk
+        size_t fill = 0;            // records in the chunk being filled
+
+        // Chunks published and written; head - tail are waiting for the writer
+        std::mutex lock;
+        std::condition_variable published;
+        std::condition_variable written;
+        size_t head = 0;
+        size_t tail = 0;
+        bool closing = false;
+        bool failed = false;
+        std::thread writer;
+
+        void Publish();
+        void WriteChunks();
+};
+
+#endif
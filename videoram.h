@@ -0,0 +1,55 @@
+#ifndef _VIDEORAM_H_
+#define _VIDEORAM_H_
+
+#include <stdint.h>
+
+// One dirty bit per line of the Space Invaders video RAM (0x2400-0x3fff,
+// 224 lines of 32 bytes, each line one column of the rotated picture). The
+// emulator marks the lines whose contents changed since it was last asked
+// and the renderer converts and uploads only the marked ones.
+struct VideoDirtyMap {
+    static const uint16_t START = 0x2400;
+    static const int LINES = 224;
+    static const int LINE_BYTES = 32;
+
+    uint64_t bits[(LINES + 63) / 64] = {};
+
+    void Mark(uint16_t address) {
+        uint16_t offset = address - START;
+        if (offset < LINES * LINE_BYTES) bits[offset >> 11] |= 1ull << ((offset >> 5) & 63);
+    }
+    void MarkAll() {
+        for (uint64_t& word : bits) word = ~0ull;
+        bits[(LINES - 1) / 64] &= ~0ull >> (64 - LINES % 64);
+    }
+    void Clear() {
+        for (uint64_t& word : bits) word = 0;
+    }
+    // Merges another map's marks into this one
+    void Merge(const VideoDirtyMap& other) {
+        for (int i = 0; i < (LINES + 63) / 64; i++) bits[i] |= other.bits[i];
+    }
+
+    bool Test(int line) const { return (bits[line >> 6] >> (line & 63)) & 1; }
+    // Any of count lines from first; count is at most 32 and the range may
+    // not straddle a 64 line word
+    bool Any(int first, int count) const {
+        return (bits[first >> 6] >> (first & 63)) & (~0ull >> (64 - count));
+    }
+    bool Any() const {
+        for (uint64_t word : bits) if (word) return true;
+        return false;
+    }
+    // Smallest span of lines holding every mark: count lines from first,
+    // count 0 if nothing is marked
+    void Span(int& first, int& count) const {
+        first = count = 0;
+        for (int line = 0; line < LINES; line++) {
+            if (!Test(line)) continue;
+            if (count == 0) first = line;
+            count = line - first + 1;
+        }
+    }
+};
+
+#endif
@@ -9,32 +9,60 @@ bool Window::Initialize() {
         std::cout << "SDL_Init Error: " << SDL_GetError() << std::endl;
         return false;
     }
-    SDL_Window *window = SDL_CreateWindow(SCREEN_TITLE, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+    window = SDL_CreateWindow(SCREEN_TITLE, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
     if (window == nullptr){
         std::cout << "SDL_CreateWindow Error: " << SDL_GetError() << std::endl;
         SDL_Quit();
         return false;
     }
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     if (renderer == nullptr){
         SDL_DestroyWindow(window);
+        window = nullptr;
         std::cout << "SDL_CreateRenderer Error: " << SDL_GetError() << std::endl;
         SDL_Quit();
         return false;
     }
-
-    SDL_Event e;
-    bool quit = false;
-    while (!quit){
-        while (SDL_PollEvent(&e)){
-            if (e.type == SDL_QUIT){
-                quit = true;
-            }
-        }
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, Renderer::WIDTH, Renderer::HEIGHT);
+    if (texture == nullptr){
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        renderer = nullptr;
+        window = nullptr;
+        std::cout << "SDL_CreateTexture Error: " << SDL_GetError() << std::endl;
+        SDL_Quit();
+        return false;
     }
+    return true;
+}
 
+Window::~Window() {
+    if (window == nullptr) return;
+    SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
+}
+
+bool Window::PollEvents(const std::function<void(SDL_Keycode key, bool pressed)>& onKey) {
+    SDL_Event e;
+    while (SDL_PollEvent(&e)){
+        if (e.type == SDL_QUIT){
+            return false;
+        }
+        if ((e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) && !e.key.repeat){
+            onKey(e.key.keysym.sym, e.type == SDL_KEYDOWN);
+        }
+    }
     return true;
 }
+
+void Window::Present(const uint32_t* pixels, int first, int count) {
+    if (count > 0) {
+        SDL_Rect columns = { first, 0, count, Renderer::HEIGHT };
+        SDL_UpdateTexture(texture, &columns, pixels + first, Renderer::WIDTH * sizeof(uint32_t));
+    }
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+    SDL_RenderPresent(renderer);
+}
@@ -3,17 +3,28 @@
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
+#include <functional>
+#include "renderer.h"
 
 class Window {
     private:
-        const int SCREEN_WIDTH   = 640;
-        const int SCREEN_HEIGHT  = 480;
+        const int SCREEN_SCALE   = 2;
+        const int SCREEN_WIDTH   = Renderer::WIDTH * SCREEN_SCALE;
+        const int SCREEN_HEIGHT  = Renderer::HEIGHT * SCREEN_SCALE;
         const char* SCREEN_TITLE = "8080 Emulator";
-        SDL_Window* window;
-        SDL_Renderer* renderer;
+        SDL_Window* window = nullptr;
+        SDL_Renderer* renderer = nullptr;
+        SDL_Texture* texture = nullptr; // streaming, Renderer::WIDTH x HEIGHT ARGB8888
     public:
+        ~Window();
         bool Initialize();
-        void Render();
+        // Handles pending events, passing key presses and releases (not key
+        // repeats) to onKey; returns false once the window is closed
+        bool PollEvents(const std::function<void(SDL_Keycode key, bool pressed)>& onKey);
+        // Uploads columns [first, first + count) of a frame from Renderer
+        // and shows the texture scaled to the window; count 0 re-presents
+        // the previous frame
+        void Present(const uint32_t* pixels, int first = 0, int count = Renderer::WIDTH);
 };
 
 #endif